@@ -0,0 +1,1355 @@
+// compares every source, adaptor and terminal of cppStream with a hand-written loop
+// and the equivalent std::views pipeline, named BM_<stage>_<stream|loop|views><T>/<size>
+#include "cppStream.hpp"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <forward_list>
+#include <memory_resource>
+#include <numeric>
+#include <queue>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#ifdef __cpp_lib_ranges
+#include <ranges>
+#include <span>
+#endif
+
+using namespace yaossg::stream;
+
+namespace {
+
+void sizes(benchmark::internal::Benchmark* b) {
+	for(int64_t n : {1 << 10, 1 << 16, 1 << 20})
+		b->Arg(n);
+}
+
+// uniform values in [-bound, bound), the same sequence on every run
+template<typename T>
+std::vector<T> make_data(size_t n, int bound = 1000) {
+	std::mt19937 engine(42);
+	std::uniform_int_distribution<int> distribution(-bound, bound - 1);
+	std::vector<T> data(n);
+	for(auto& element : data)
+		element = T(distribution(engine));
+	return data;
+}
+
+// function objects rather than function pointers, as they are usually passed
+struct Positive {
+	template<typename T>
+	bool operator()(T x) const {
+		return x > T(0);
+	}
+};
+
+struct Affine {
+	template<typename T>
+	T operator()(T x) const {
+		return x * T(3) + T(1);
+	}
+};
+
+struct NextValue {
+	template<typename T>
+	T operator()(T x) const {
+		return T((int64_t(x) * 1103515245 + 12345) % 65536);
+	}
+};
+
+constexpr Positive positive;
+constexpr Affine affine;
+constexpr NextValue next_value;
+
+// stable sorts as many chunks as there are hardware threads on their own threads, then merges them pairwise
+template<typename T, typename Sort, typename Merge>
+void sort_on_threads(std::vector<T>& data, Sort sort_chunk, Merge merge) {
+	size_t chunks = std::max(std::thread::hardware_concurrency(), 1u);
+	std::vector<size_t> bounds;
+	for(size_t i = 0; i <= chunks; ++i)
+		bounds.push_back(data.size() * i / chunks);
+	std::vector<std::thread> threads;
+	for(size_t i = 0; i != chunks; ++i)
+		threads.emplace_back([&, i] { sort_chunk(data.begin() + bounds[i], data.begin() + bounds[i + 1]); });
+	for(auto& thread : threads)
+		thread.join();
+	for(size_t width = 1; width < chunks; width *= 2)
+		for(size_t i = 0; i + width < chunks; i += 2 * width)
+			merge(data.begin() + bounds[i], data.begin() + bounds[i + width], data.begin() + bounds[std::min(i + 2 * width, chunks)]);
+}
+
+// writes sorted runs of run elements to temporary files, then merges them with a heap reading blocks of 1024
+template<typename T, typename Sort, typename Consumer>
+void external_sort_by_hand(std::vector<T> const& data, size_t run, Sort sort_run, Consumer consume) {
+	struct Run {
+		std::unique_ptr<std::FILE, FileCloser> file;
+		std::vector<T> block;
+		size_t position = 0;
+		
+		bool refill() {
+			block.resize(1024);
+			block.resize(std::fread(block.data(), sizeof(T), block.size(), file.get()));
+			position = 0;
+			return !block.empty();
+		}
+	};
+	std::vector<Run> runs;
+	std::vector<T> buffer;
+	for(size_t first = 0; first < data.size(); first += run) {
+		buffer.assign(data.begin() + first, data.begin() + std::min(first + run, data.size()));
+		sort_run(buffer);
+		Run& spilled = runs.emplace_back();
+		spilled.file.reset(std::tmpfile());
+		std::fwrite(buffer.data(), sizeof(T), buffer.size(), spilled.file.get());
+		std::rewind(spilled.file.get());
+	}
+	using Head = std::pair<T, size_t>;
+	std::priority_queue<Head, std::vector<Head>, std::greater<>> heap;
+	for(size_t i = 0; i != runs.size(); ++i)
+		if(runs[i].refill())
+			heap.emplace(runs[i].block[0], i);
+	while(!heap.empty()) {
+		auto [x, i] = heap.top();
+		heap.pop();
+		consume(x);
+		Run& current = runs[i];
+		if(++current.position != current.block.size() || current.refill())
+			heap.emplace(current.block[current.position], i);
+	}
+}
+
+}
+
+#define CPP_STREAM_BENCHMARK(name) \
+	BENCHMARK_TEMPLATE(name, int32_t)->Apply(sizes); \
+	BENCHMARK_TEMPLATE(name, int64_t)->Apply(sizes); \
+	BENCHMARK_TEMPLATE(name, double)->Apply(sizes)
+
+#define CPP_STREAM_BENCHMARK_INTEGRAL(name) \
+	BENCHMARK_TEMPLATE(name, int32_t)->Apply(sizes); \
+	BENCHMARK_TEMPLATE(name, int64_t)->Apply(sizes)
+
+// sources
+
+template<typename T>
+void BM_from_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(from(data) >> reduce(std::plus<>{}));
+}
+
+template<typename T>
+void BM_from_loop(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state) {
+		T sum = 0;
+		for(T x : data)
+			sum += x;
+		benchmark::DoNotOptimize(sum);
+	}
+}
+
+template<typename T>
+void BM_int_range_stream(benchmark::State& state) {
+	T n = T(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(int_range(T(0), n) >> reduce(std::plus<>{}));
+}
+
+template<typename T>
+void BM_int_range_loop(benchmark::State& state) {
+	T n = T(state.range(0));
+	for(auto _ : state) {
+		T sum = 0;
+		for(T i = 0; i < n; ++i)
+			sum += i;
+		benchmark::DoNotOptimize(sum);
+	}
+}
+
+template<typename T>
+void BM_iota_stream(benchmark::State& state) {
+	size_t n = state.range(0);
+	for(auto _ : state)
+		benchmark::DoNotOptimize(iota(T(0), T(2)) >> take(n) >> reduce(std::plus<>{}));
+}
+
+template<typename T>
+void BM_iota_loop(benchmark::State& state) {
+	size_t n = state.range(0);
+	for(auto _ : state) {
+		T sum = 0, value = 0;
+		for(size_t i = 0; i != n; ++i, value += T(2))
+			sum += value;
+		benchmark::DoNotOptimize(sum);
+	}
+}
+
+template<typename T>
+void BM_generate_stream(benchmark::State& state) {
+	size_t n = state.range(0);
+	for(auto _ : state) {
+		T value = 0;
+		benchmark::DoNotOptimize(generate([&value] { return value = next_value(value); })
+			>> take(n) >> reduce(std::plus<>{}));
+	}
+}
+
+template<typename T>
+void BM_generate_loop(benchmark::State& state) {
+	size_t n = state.range(0);
+	for(auto _ : state) {
+		T sum = 0, value = 0;
+		for(size_t i = 0; i != n; ++i)
+			sum += value = next_value(value);
+		benchmark::DoNotOptimize(sum);
+	}
+}
+
+template<typename T>
+void BM_iterate_stream(benchmark::State& state) {
+	size_t n = state.range(0);
+	for(auto _ : state)
+		benchmark::DoNotOptimize(iterate(T(1), next_value) >> take(n) >> reduce(std::plus<>{}));
+}
+
+template<typename T>
+void BM_iterate_loop(benchmark::State& state) {
+	size_t n = state.range(0);
+	for(auto _ : state) {
+		T sum = 0, value = 1;
+		for(size_t i = 0; i != n; ++i, value = next_value(value))
+			sum += value;
+		benchmark::DoNotOptimize(sum);
+	}
+}
+
+CPP_STREAM_BENCHMARK(BM_from_stream);
+CPP_STREAM_BENCHMARK(BM_from_loop);
+CPP_STREAM_BENCHMARK_INTEGRAL(BM_int_range_stream);
+CPP_STREAM_BENCHMARK_INTEGRAL(BM_int_range_loop);
+CPP_STREAM_BENCHMARK(BM_iota_stream);
+CPP_STREAM_BENCHMARK(BM_iota_loop);
+CPP_STREAM_BENCHMARK(BM_generate_stream);
+CPP_STREAM_BENCHMARK(BM_generate_loop);
+CPP_STREAM_BENCHMARK(BM_iterate_stream);
+CPP_STREAM_BENCHMARK(BM_iterate_loop);
+
+// adaptors
+
+template<typename T>
+void BM_filter_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(from(data) >> filter(positive) >> reduce(std::plus<>{}));
+}
+
+template<typename T>
+void BM_filter_loop(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state) {
+		T sum = 0;
+		for(T x : data)
+			if(positive(x))
+				sum += x;
+		benchmark::DoNotOptimize(sum);
+	}
+}
+
+template<typename T>
+void BM_map_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(from(data) >> map(affine) >> reduce(std::plus<>{}));
+}
+
+template<typename T>
+void BM_map_loop(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state) {
+		T sum = 0;
+		for(T x : data)
+			sum += affine(x);
+		benchmark::DoNotOptimize(sum);
+	}
+}
+
+// several adjacent stages of the same kind are fused into one
+template<typename T>
+void BM_pipeline_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(from(data) >> map(affine) >> map(affine) >> filter(positive) >> filter(positive)
+			>> skip(1) >> skip(1) >> reduce(std::plus<>{}));
+}
+
+template<typename T>
+void BM_pipeline_loop(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state) {
+		T sum = 0;
+		size_t skipped = 0;
+		for(T x : data) {
+			T y = affine(affine(x));
+			if(positive(y) && positive(y) && skipped++ >= 2)
+				sum += y;
+		}
+		benchmark::DoNotOptimize(sum);
+	}
+}
+
+template<typename T>
+void BM_sort_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		from(data) >> sort() >> for_each([](T x) { benchmark::DoNotOptimize(x); });
+}
+
+template<typename T>
+void BM_sort_loop(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state) {
+		auto copy = data;
+		std::stable_sort(copy.begin(), copy.end());
+		for(T x : copy)
+			benchmark::DoNotOptimize(x);
+	}
+}
+
+template<typename T>
+void BM_sort_arena_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	std::vector<std::byte> storage(data.size() * sizeof(T) * 3);
+	for(auto _ : state) {
+		std::pmr::monotonic_buffer_resource arena(storage.data(), storage.size());
+		from(data) >> with_arena(&arena) >> sort() >> for_each([](T x) { benchmark::DoNotOptimize(x); });
+	}
+}
+
+template<typename T>
+void BM_sort_arena_loop(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	std::vector<std::byte> storage(data.size() * sizeof(T) * 3);
+	for(auto _ : state) {
+		std::pmr::monotonic_buffer_resource arena(storage.data(), storage.size());
+		std::pmr::vector<T> copy(data.begin(), data.end(), &arena);
+		std::stable_sort(copy.begin(), copy.end());
+		for(T x : copy)
+			benchmark::DoNotOptimize(x);
+	}
+}
+
+template<typename T>
+void BM_sort_parallel_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		from(data) >> sort(par) >> for_each([](T x) { benchmark::DoNotOptimize(x); });
+}
+
+template<typename T>
+void BM_sort_parallel_loop(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state) {
+		auto copy = data;
+		sort_on_threads(copy, [](auto first, auto last) { std::stable_sort(first, last); }, 
+			[](auto first, auto middle, auto last) { std::inplace_merge(first, middle, last); });
+		for(T x : copy)
+			benchmark::DoNotOptimize(x);
+	}
+}
+
+template<typename T>
+void BM_reverse_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(from(data) >> map([](T x) { return x * 3; }) >> reverse() >> take(data.size() / 2) >> reduce(std::plus<>{}));
+}
+
+template<typename T>
+void BM_reverse_loop(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state) {
+		T sum = 0;
+		for(size_t i = data.size(); i != data.size() - data.size() / 2; --i)
+			sum += data[i - 1] * 3;
+		benchmark::DoNotOptimize(sum);
+	}
+}
+
+template<typename T>
+void BM_reverse_buffered_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	std::forward_list<T> list(data.begin(), data.end());
+	for(auto _ : state)
+		benchmark::DoNotOptimize(from(list) >> map([](T x) { return x * 3; }) >> reverse() >> take(data.size() / 2) >> reduce(std::plus<>{}));
+}
+
+template<typename T>
+void BM_reverse_buffered_loop(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	std::forward_list<T> list(data.begin(), data.end());
+	for(auto _ : state) {
+		std::vector<T> buffer;
+		for(T x : list)
+			buffer.push_back(x * 3);
+		T sum = 0;
+		for(size_t i = buffer.size(); i != buffer.size() - buffer.size() / 2; --i)
+			sum += buffer[i - 1];
+		benchmark::DoNotOptimize(sum);
+	}
+}
+
+template<typename T>
+void BM_sort_take_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(from(data) >> sort() >> take(10) >> reduce(std::plus<>{}));
+}
+
+template<typename T>
+void BM_sort_take_loop(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state) {
+		auto copy = data;
+		std::partial_sort(copy.begin(), copy.begin() + 10, copy.end());
+		benchmark::DoNotOptimize(std::accumulate(copy.begin(), copy.begin() + 10, T(0)));
+	}
+}
+
+// spills runs of an eighth of the data
+template<typename T>
+void BM_external_sort_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		from(data) >> external_sort(data.size() * sizeof(T) / 8) >> for_each([](T x) { benchmark::DoNotOptimize(x); });
+}
+
+template<typename T>
+void BM_external_sort_loop(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		external_sort_by_hand(data, data.size() / 8, [](std::vector<T>& run) { std::stable_sort(run.begin(), run.end()); }, 
+			[](T x) { benchmark::DoNotOptimize(x); });
+}
+
+// 16 sorted shards
+template<typename T>
+std::vector<std::vector<T>> make_shards(size_t n) {
+	auto data = make_data<T>(n);
+	std::vector<std::vector<T>> shards(16);
+	for(size_t i = 0; i != n; ++i)
+		shards[i % 16].push_back(data[i]);
+	for(auto& shard : shards)
+		std::sort(shard.begin(), shard.end());
+	return shards;
+}
+
+template<typename T>
+void BM_merge_streams_stream(benchmark::State& state) {
+	auto shards = make_shards<T>(state.range(0));
+	for(auto _ : state) {
+		std::vector<decltype(from(shards[0]))> streams;
+		for(auto& shard : shards)
+			streams.push_back(from(shard));
+		benchmark::DoNotOptimize(merge_streams(std::less<>{}, std::move(streams)) >> take(state.range(0) / 2) >> reduce(std::plus<>{}));
+	}
+}
+
+template<typename T>
+void BM_merge_streams_loop(benchmark::State& state) {
+	auto shards = make_shards<T>(state.range(0));
+	for(auto _ : state) {
+		using Head = std::pair<T, size_t>;
+		std::priority_queue<Head, std::vector<Head>, std::greater<>> heap;
+		std::vector<size_t> positions(shards.size());
+		for(size_t i = 0; i != shards.size(); ++i)
+			if(!shards[i].empty())
+				heap.emplace(shards[i][0], i);
+		T sum = 0;
+		for(int64_t k = state.range(0) / 2; k-- && !heap.empty();) {
+			auto [x, i] = heap.top();
+			heap.pop();
+			sum += x;
+			if(++positions[i] != shards[i].size())
+				heap.emplace(shards[i][positions[i]], i);
+		}
+		benchmark::DoNotOptimize(sum);
+	}
+}
+
+template<typename T>
+void BM_sliding_min_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(from(data) >> sliding_reduce(64, [](T a, T b) { return std::min(a, b); }) >> reduce(std::plus<>{}));
+}
+
+template<typename T>
+void BM_sliding_min_loop(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state) {
+		T sum = 0;
+		for(size_t i = 0; i + 64 <= data.size(); ++i)
+			sum += *std::min_element(data.begin() + i, data.begin() + i + 64);
+		benchmark::DoNotOptimize(sum);
+	}
+}
+
+template<typename T>
+void BM_distinct_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0), int(state.range(0) / 4));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(from(data) >> distinct() >> count(0));
+}
+
+template<typename T>
+void BM_distinct_loop(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0), int(state.range(0) / 4));
+	for(auto _ : state) {
+		std::unordered_set<T> seen;
+		int counter = 0;
+		for(T x : data)
+			counter += seen.insert(x).second;
+		benchmark::DoNotOptimize(counter);
+	}
+}
+
+template<typename T>
+void BM_flat_map_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0) / 8);
+	for(auto _ : state)
+		benchmark::DoNotOptimize(from(data)
+			>> flat_map([](T x) { return int_range(int(x) & 15); }) >> reduce(std::plus<>{}));
+}
+
+template<typename T>
+void BM_flat_map_loop(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0) / 8);
+	for(auto _ : state) {
+		int sum = 0;
+		for(T x : data)
+			for(int i = 0, n = int(x) & 15; i != n; ++i)
+				sum += i;
+		benchmark::DoNotOptimize(sum);
+	}
+}
+
+template<typename T>
+void BM_join_streams_stream(benchmark::State& state) {
+	auto a = make_data<T>(state.range(0) / 2), b = make_data<T>(state.range(0) / 2);
+	for(auto _ : state)
+		benchmark::DoNotOptimize(join_streams(from(a), from(b)) >> reduce(std::plus<>{}));
+}
+
+template<typename T>
+void BM_join_streams_many_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	auto quarter = [&](size_t i) { return from(data) >> skip(data.size() * i / 4) >> take(data.size() / 4); };
+	for(auto _ : state)
+		benchmark::DoNotOptimize(join_streams(quarter(0), quarter(1), quarter(2), quarter(3)) >> map([](T x) { return x; }) >> reduce(std::plus<>{}));
+}
+
+template<typename T>
+void BM_split_gather_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(gather(from(data) >> split(4)) >> map([](T x) { return x; }) >> reduce(std::plus<>{}));
+}
+
+template<typename T>
+void BM_join_streams_many_loop(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state) {
+		T sum = 0;
+		for(size_t i = 0; i != 4; ++i)
+			for(size_t j = data.size() * i / 4; j != data.size() * (i + 1) / 4; ++j)
+				sum += data[j];
+		benchmark::DoNotOptimize(sum);
+	}
+}
+
+// both read the four quarters one after another
+template<typename T>
+void BM_split_gather_loop(benchmark::State& state) {
+	BM_join_streams_many_loop<T>(state);
+}
+
+template<typename T>
+void BM_join_streams_loop(benchmark::State& state) {
+	auto a = make_data<T>(state.range(0) / 2), b = make_data<T>(state.range(0) / 2);
+	for(auto _ : state) {
+		T sum = 0;
+		for(T x : a)
+			sum += x;
+		for(T x : b)
+			sum += x;
+		benchmark::DoNotOptimize(sum);
+	}
+}
+
+template<typename T>
+void BM_combine_streams_stream(benchmark::State& state) {
+	auto a = make_data<T>(state.range(0)), b = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(combine_streams(std::multiplies<>{}, from(a), from(b)) >> reduce(std::plus<>{}));
+}
+
+template<typename T>
+void BM_combine_streams_loop(benchmark::State& state) {
+	auto a = make_data<T>(state.range(0)), b = make_data<T>(state.range(0));
+	for(auto _ : state) {
+		T sum = 0;
+		for(size_t i = 0; i != a.size(); ++i)
+			sum += a[i] * b[i];
+		benchmark::DoNotOptimize(sum);
+	}
+}
+
+CPP_STREAM_BENCHMARK(BM_filter_stream);
+CPP_STREAM_BENCHMARK(BM_filter_loop);
+CPP_STREAM_BENCHMARK(BM_map_stream);
+CPP_STREAM_BENCHMARK(BM_map_loop);
+CPP_STREAM_BENCHMARK(BM_pipeline_stream);
+CPP_STREAM_BENCHMARK(BM_pipeline_loop);
+CPP_STREAM_BENCHMARK(BM_sort_stream);
+CPP_STREAM_BENCHMARK(BM_sort_loop);
+CPP_STREAM_BENCHMARK(BM_sort_arena_stream);
+CPP_STREAM_BENCHMARK(BM_sort_arena_loop);
+CPP_STREAM_BENCHMARK(BM_sort_parallel_stream);
+CPP_STREAM_BENCHMARK(BM_sort_parallel_loop);
+CPP_STREAM_BENCHMARK(BM_reverse_stream);
+CPP_STREAM_BENCHMARK(BM_reverse_loop);
+CPP_STREAM_BENCHMARK(BM_reverse_buffered_stream);
+CPP_STREAM_BENCHMARK(BM_reverse_buffered_loop);
+CPP_STREAM_BENCHMARK(BM_sort_take_stream);
+CPP_STREAM_BENCHMARK(BM_sort_take_loop);
+CPP_STREAM_BENCHMARK(BM_external_sort_stream);
+CPP_STREAM_BENCHMARK(BM_external_sort_loop);
+CPP_STREAM_BENCHMARK(BM_merge_streams_stream);
+CPP_STREAM_BENCHMARK(BM_merge_streams_loop);
+CPP_STREAM_BENCHMARK(BM_sliding_min_stream);
+CPP_STREAM_BENCHMARK(BM_sliding_min_loop);
+CPP_STREAM_BENCHMARK(BM_distinct_stream);
+CPP_STREAM_BENCHMARK(BM_distinct_loop);
+CPP_STREAM_BENCHMARK_INTEGRAL(BM_flat_map_stream);
+CPP_STREAM_BENCHMARK_INTEGRAL(BM_flat_map_loop);
+CPP_STREAM_BENCHMARK(BM_join_streams_stream);
+CPP_STREAM_BENCHMARK(BM_join_streams_loop);
+CPP_STREAM_BENCHMARK(BM_join_streams_many_stream);
+CPP_STREAM_BENCHMARK(BM_join_streams_many_loop);
+CPP_STREAM_BENCHMARK(BM_split_gather_stream);
+CPP_STREAM_BENCHMARK(BM_split_gather_loop);
+CPP_STREAM_BENCHMARK(BM_combine_streams_stream);
+CPP_STREAM_BENCHMARK(BM_combine_streams_loop);
+
+// terminals
+
+template<typename T>
+void BM_for_each_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		from(data) >> for_each([](T x) { benchmark::DoNotOptimize(x); });
+}
+
+template<typename T>
+void BM_for_each_loop(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		for(T x : data)
+			benchmark::DoNotOptimize(x);
+}
+
+template<typename T>
+void BM_count_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(from(data) >> filter(positive) >> count(0));
+}
+
+template<typename T>
+void BM_count_loop(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state) {
+		int counter = 0;
+		for(T x : data)
+			counter += positive(x);
+		benchmark::DoNotOptimize(counter);
+	}
+}
+
+template<typename T>
+void BM_minmax_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(from(data) >> minmax());
+}
+
+template<typename T>
+void BM_minmax_loop(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state) {
+		T min = data.front(), max = data.front();
+		for(T x : data)
+			min = std::min(min, x), max = std::max(max, x);
+		benchmark::DoNotOptimize(min);
+		benchmark::DoNotOptimize(max);
+	}
+}
+
+template<typename T>
+void BM_any_match_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(from(data) >> any_match([](T x) { return x > T(1000); }));
+}
+
+template<typename T>
+void BM_any_match_loop(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state) {
+		bool found = false;
+		for(T x : data)
+			if(x > T(1000)) {
+				found = true;
+				break;
+			}
+		benchmark::DoNotOptimize(found);
+	}
+}
+
+template<typename T>
+void BM_min_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(from(data) >> min());
+}
+
+template<typename T>
+void BM_min_loop(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state) {
+		T min = data.front();
+		for(T x : data)
+			min = std::min(min, x);
+		benchmark::DoNotOptimize(min);
+	}
+}
+
+template<typename T>
+void BM_max_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(from(data) >> max());
+}
+
+template<typename T>
+void BM_max_loop(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state) {
+		T max = data.front();
+		for(T x : data)
+			max = std::max(max, x);
+		benchmark::DoNotOptimize(max);
+	}
+}
+
+// every element matches, so the whole input is read
+template<typename T>
+void BM_all_match_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(from(data) >> all_match([](T x) { return x < T(1000); }));
+}
+
+template<typename T>
+void BM_all_match_loop(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state) {
+		bool all = true;
+		for(T x : data)
+			if(!(x < T(1000))) {
+				all = false;
+				break;
+			}
+		benchmark::DoNotOptimize(all);
+	}
+}
+
+template<typename T>
+void BM_none_match_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(from(data) >> none_match([](T x) { return x > T(1000); }));
+}
+
+template<typename T>
+void BM_none_match_loop(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state) {
+		bool none = true;
+		for(T x : data)
+			if(x > T(1000)) {
+				none = false;
+				break;
+			}
+		benchmark::DoNotOptimize(none);
+	}
+}
+
+// the first occurrence of the last element
+template<typename T>
+void BM_first_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	T last = data.back();
+	for(auto _ : state)
+		benchmark::DoNotOptimize(from(data) >> filter([last](T x) { return x == last; }) >> first());
+}
+
+template<typename T>
+void BM_first_loop(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	T last = data.back();
+	for(auto _ : state) {
+		T found = 0;
+		for(T x : data)
+			if(x == last) {
+				found = x;
+				break;
+			}
+		benchmark::DoNotOptimize(found);
+	}
+}
+
+// the positive element at a quarter of the positive ones
+template<typename T>
+void BM_element_at_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	size_t pos = data.size() / 8;
+	for(auto _ : state)
+		benchmark::DoNotOptimize(from(data) >> filter(positive) >> element_at(pos));
+}
+
+template<typename T>
+void BM_element_at_loop(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	size_t pos = data.size() / 8;
+	for(auto _ : state) {
+		T found = 0;
+		size_t seen = 0;
+		for(T x : data)
+			if(positive(x) && seen++ == pos) {
+				found = x;
+				break;
+			}
+		benchmark::DoNotOptimize(found);
+	}
+}
+
+template<typename T>
+void BM_collect_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(from(data) >> map(affine) >> collect(std::vector<T>{},
+			[](std::vector<T>& container, T x) { container.push_back(x); }));
+}
+
+template<typename T>
+void BM_to_vector_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(from(data) >> map(affine) >> to_vector());
+}
+
+template<typename T>
+void BM_into_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	std::vector<T> result;
+	for(auto _ : state) {
+		result.clear();
+		benchmark::DoNotOptimize((from(data) >> map(affine) >> into(result)).data());
+	}
+}
+
+template<typename T>
+void BM_into_loop(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	std::vector<T> result;
+	for(auto _ : state) {
+		result.clear();
+		for(T x : data)
+			result.push_back(affine(x));
+		benchmark::DoNotOptimize(result.data());
+	}
+}
+
+// a round trip through a temporary file
+template<typename T>
+void BM_serialize_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	std::unique_ptr<std::FILE, FileCloser> file(std::tmpfile());
+	for(auto _ : state) {
+		std::rewind(file.get());
+		from(data) >> serialize_to(file.get());
+		std::rewind(file.get());
+		benchmark::DoNotOptimize(deserialize_from<T>(file.get()) >> reduce(std::plus<>{}));
+	}
+}
+
+template<typename T>
+void BM_serialize_loop(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	std::unique_ptr<std::FILE, FileCloser> file(std::tmpfile());
+	std::vector<T> block((size_t(1) << 16) / sizeof(T));
+	for(auto _ : state) {
+		std::rewind(file.get());
+		std::fwrite(data.data(), sizeof(T), data.size(), file.get());
+		std::rewind(file.get());
+		T sum = 0;
+		for(size_t n = data.size(), k; n; n -= k) {
+			k = std::fread(block.data(), sizeof(T), std::min(n, block.size()), file.get());
+			for(size_t i = 0; i != k; ++i)
+				sum += block[i];
+		}
+		benchmark::DoNotOptimize(sum);
+	}
+}
+
+template<typename T>
+void BM_collect_loop(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state) {
+		std::vector<T> result;
+		result.reserve(data.size());
+		for(T x : data)
+			result.push_back(affine(x));
+		benchmark::DoNotOptimize(result.data());
+	}
+}
+
+// to_vector reserves the size of a sized stream like this
+template<typename T>
+void BM_to_vector_loop(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state) {
+		std::vector<T> result(data.size());
+		std::transform(data.begin(), data.end(), result.begin(), affine);
+		benchmark::DoNotOptimize(result.data());
+	}
+}
+
+// 2000 distinct keys
+template<typename T>
+void BM_counting_by_stream(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(from(data) >> counting_by([](T x) { return int64_t(x); }));
+}
+
+template<typename T>
+void BM_counting_by_parallel(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(from(data) >> counting_by(par, [](T x) { return int64_t(x); }));
+}
+
+template<typename T>
+void BM_counting_by_loop(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state) {
+		std::unordered_map<int64_t, size_t> counts;
+		for(T x : data)
+			++counts[int64_t(x)];
+		benchmark::DoNotOptimize(counts);
+	}
+}
+
+CPP_STREAM_BENCHMARK(BM_for_each_stream);
+CPP_STREAM_BENCHMARK(BM_for_each_loop);
+CPP_STREAM_BENCHMARK(BM_count_stream);
+CPP_STREAM_BENCHMARK(BM_count_loop);
+CPP_STREAM_BENCHMARK(BM_minmax_stream);
+CPP_STREAM_BENCHMARK(BM_minmax_loop);
+CPP_STREAM_BENCHMARK(BM_any_match_stream);
+CPP_STREAM_BENCHMARK(BM_any_match_loop);
+CPP_STREAM_BENCHMARK(BM_min_stream);
+CPP_STREAM_BENCHMARK(BM_min_loop);
+CPP_STREAM_BENCHMARK(BM_max_stream);
+CPP_STREAM_BENCHMARK(BM_max_loop);
+CPP_STREAM_BENCHMARK(BM_all_match_stream);
+CPP_STREAM_BENCHMARK(BM_all_match_loop);
+CPP_STREAM_BENCHMARK(BM_none_match_stream);
+CPP_STREAM_BENCHMARK(BM_none_match_loop);
+CPP_STREAM_BENCHMARK(BM_first_stream);
+CPP_STREAM_BENCHMARK(BM_first_loop);
+CPP_STREAM_BENCHMARK(BM_element_at_stream);
+CPP_STREAM_BENCHMARK(BM_element_at_loop);
+CPP_STREAM_BENCHMARK(BM_collect_stream);
+CPP_STREAM_BENCHMARK(BM_collect_loop);
+CPP_STREAM_BENCHMARK(BM_to_vector_stream);
+CPP_STREAM_BENCHMARK(BM_to_vector_loop);
+CPP_STREAM_BENCHMARK(BM_into_stream);
+CPP_STREAM_BENCHMARK(BM_into_loop);
+CPP_STREAM_BENCHMARK(BM_serialize_stream);
+CPP_STREAM_BENCHMARK(BM_serialize_loop);
+CPP_STREAM_BENCHMARK(BM_counting_by_stream);
+CPP_STREAM_BENCHMARK(BM_counting_by_parallel);
+CPP_STREAM_BENCHMARK(BM_counting_by_loop);
+
+#ifdef __cpp_lib_ranges
+// the std::views baselines, generate, iterate and distinct have no counterpart in std::views
+
+template<typename T, typename View>
+T sum_of(View&& view) {
+	T sum = 0;
+	for(T x : view)
+		sum += x;
+	return sum;
+}
+
+template<typename T>
+void BM_from_views(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(sum_of<T>(std::views::all(data)));
+}
+
+template<typename T>
+void BM_int_range_views(benchmark::State& state) {
+	T n = T(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(sum_of<T>(std::views::iota(T(0), n)));
+}
+
+template<typename T>
+void BM_iota_views(benchmark::State& state) {
+	int64_t n = state.range(0);
+	for(auto _ : state)
+		benchmark::DoNotOptimize(sum_of<T>(std::views::iota(int64_t(0), n)
+			| std::views::transform([](int64_t i) { return T(i * 2); })));
+}
+
+template<typename T>
+void BM_filter_views(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(sum_of<T>(data | std::views::filter(positive)));
+}
+
+template<typename T>
+void BM_map_views(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(sum_of<T>(data | std::views::transform(affine)));
+}
+
+template<typename T>
+void BM_pipeline_views(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(sum_of<T>(data | std::views::transform(affine) | std::views::transform(affine) 
+			| std::views::filter(positive) | std::views::filter(positive) | std::views::drop(1) | std::views::drop(1)));
+}
+
+template<typename T>
+void BM_sort_views(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state) {
+		auto copy = data;
+		std::ranges::stable_sort(copy);
+		std::ranges::for_each(copy, [](T x) { benchmark::DoNotOptimize(x); });
+	}
+}
+
+template<typename T>
+void BM_sort_arena_views(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	std::vector<std::byte> storage(data.size() * sizeof(T) * 3);
+	for(auto _ : state) {
+		std::pmr::monotonic_buffer_resource arena(storage.data(), storage.size());
+		std::pmr::vector<T> copy(data.begin(), data.end(), &arena);
+		std::ranges::stable_sort(copy);
+		std::ranges::for_each(copy, [](T x) { benchmark::DoNotOptimize(x); });
+	}
+}
+
+template<typename T>
+void BM_sort_parallel_views(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state) {
+		auto copy = data;
+		sort_on_threads(copy, [](auto first, auto last) { std::ranges::stable_sort(first, last); }, 
+			[](auto first, auto middle, auto last) { std::ranges::inplace_merge(first, middle, last); });
+		std::ranges::for_each(copy, [](T x) { benchmark::DoNotOptimize(x); });
+	}
+}
+
+template<typename T>
+void BM_reverse_views(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(sum_of<T>(data | std::views::transform([](T x) { return x * 3; }) 
+			| std::views::reverse | std::views::take(data.size() / 2)));
+}
+
+// std::views::reverse needs a bidirectional range, so the list is copied first
+template<typename T>
+void BM_reverse_buffered_views(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	std::forward_list<T> list(data.begin(), data.end());
+	for(auto _ : state) {
+		std::vector<T> buffer;
+		std::ranges::copy(list | std::views::transform([](T x) { return x * 3; }), std::back_inserter(buffer));
+		benchmark::DoNotOptimize(sum_of<T>(buffer | std::views::reverse | std::views::take(buffer.size() / 2)));
+	}
+}
+
+template<typename T>
+void BM_external_sort_views(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		external_sort_by_hand(data, data.size() / 8, [](std::vector<T>& run) { std::ranges::stable_sort(run); }, 
+			[](T x) { benchmark::DoNotOptimize(x); });
+}
+
+template<typename T>
+void BM_sort_take_views(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state) {
+		auto copy = data;
+		std::ranges::partial_sort(copy, copy.begin() + 10);
+		benchmark::DoNotOptimize(sum_of<T>(copy | std::views::take(10)));
+	}
+}
+
+template<typename T>
+void BM_flat_map_views(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0) / 8);
+	for(auto _ : state)
+		benchmark::DoNotOptimize(sum_of<int>(data
+			| std::views::transform([](T x) { return std::views::iota(0, int(x) & 15); }) | std::views::join));
+}
+
+template<typename T>
+void BM_join_streams_views(benchmark::State& state) {
+	auto a = make_data<T>(state.range(0) / 2), b = make_data<T>(state.range(0) / 2);
+	for(auto _ : state) {
+		std::array<std::span<T const>, 2> parts{std::span<T const>(a), std::span<T const>(b)};
+		benchmark::DoNotOptimize(sum_of<T>(parts | std::views::join));
+	}
+}
+
+template<typename T>
+void BM_join_streams_many_views(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	auto quarter = [&](size_t i) { return data | std::views::drop(data.size() * i / 4) | std::views::take(data.size() / 4); };
+	for(auto _ : state) {
+		std::array parts{quarter(0), quarter(1), quarter(2), quarter(3)};
+		benchmark::DoNotOptimize(sum_of<T>(parts | std::views::join));
+	}
+}
+
+template<typename T>
+void BM_split_gather_views(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state) {
+		std::span<T const> all(data);
+		auto shard = [&](size_t i) { return all.subspan(data.size() * i / 4, data.size() * (i + 1) / 4 - data.size() * i / 4); };
+		std::array parts{shard(0), shard(1), shard(2), shard(3)};
+		benchmark::DoNotOptimize(sum_of<T>(parts | std::views::join));
+	}
+}
+
+#ifdef __cpp_lib_ranges_zip
+template<typename T>
+void BM_combine_streams_views(benchmark::State& state) {
+	auto a = make_data<T>(state.range(0)), b = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(sum_of<T>(std::views::zip_transform(std::multiplies<>{}, a, b)));
+}
+
+CPP_STREAM_BENCHMARK(BM_combine_streams_views);
+#endif
+
+template<typename T>
+void BM_for_each_views(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		std::ranges::for_each(data, [](T x) { benchmark::DoNotOptimize(x); });
+}
+
+template<typename T>
+void BM_count_views(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(std::ranges::count_if(data, positive));
+}
+
+template<typename T>
+void BM_minmax_views(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(std::ranges::minmax(data));
+}
+
+template<typename T>
+void BM_any_match_views(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(std::ranges::any_of(data, [](T x) { return x > T(1000); }));
+}
+
+template<typename T>
+void BM_min_views(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(std::ranges::min(data));
+}
+
+template<typename T>
+void BM_max_views(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(std::ranges::max(data));
+}
+
+template<typename T>
+void BM_all_match_views(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(std::ranges::all_of(data, [](T x) { return x < T(1000); }));
+}
+
+template<typename T>
+void BM_none_match_views(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(std::ranges::none_of(data, [](T x) { return x > T(1000); }));
+}
+
+template<typename T>
+void BM_first_views(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	T last = data.back();
+	for(auto _ : state) {
+		auto found = data | std::views::filter([last](T x) { return x == last; });
+		benchmark::DoNotOptimize(*found.begin());
+	}
+}
+
+template<typename T>
+void BM_element_at_views(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	size_t pos = data.size() / 8;
+	for(auto _ : state) {
+		auto positives = data | std::views::filter(positive);
+		benchmark::DoNotOptimize(*std::ranges::next(positives.begin(), pos));
+	}
+}
+
+template<typename T>
+void BM_collect_views(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state) {
+		std::vector<T> result;
+		result.reserve(data.size());
+		std::ranges::copy(data | std::views::transform(affine), std::back_inserter(result));
+		benchmark::DoNotOptimize(result.data());
+	}
+}
+
+template<typename T>
+void BM_to_vector_views(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state) {
+		auto mapped = data | std::views::transform(affine);
+		std::vector<T> result(mapped.begin(), mapped.end());
+		benchmark::DoNotOptimize(result.data());
+	}
+}
+
+template<typename T>
+void BM_into_views(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	std::vector<T> result;
+	for(auto _ : state) {
+		result.clear();
+		std::ranges::copy(data | std::views::transform(affine), std::back_inserter(result));
+		benchmark::DoNotOptimize(result.data());
+	}
+}
+
+// the bytes are written and read as in BM_serialize_loop, the blocks are summed as spans
+template<typename T>
+void BM_serialize_views(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	std::unique_ptr<std::FILE, FileCloser> file(std::tmpfile());
+	std::vector<T> block((size_t(1) << 16) / sizeof(T));
+	for(auto _ : state) {
+		std::rewind(file.get());
+		std::fwrite(data.data(), sizeof(T), data.size(), file.get());
+		std::rewind(file.get());
+		T sum = 0;
+		for(size_t n = data.size(), k; n; n -= k) {
+			k = std::fread(block.data(), sizeof(T), std::min(n, block.size()), file.get());
+			sum += sum_of<T>(std::span<T const>(block.data(), k));
+		}
+		benchmark::DoNotOptimize(sum);
+	}
+}
+
+// cppStream pipelines consumed as ranges
+template<typename T>
+void BM_pipeline_iterable_views(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(sum_of<T>(from(data) >> map(affine) >> filter(positive) >> iterable()));
+}
+
+template<typename T>
+void BM_count_iterable_views(benchmark::State& state) {
+	auto data = make_data<T>(state.range(0));
+	for(auto _ : state)
+		benchmark::DoNotOptimize(std::ranges::count_if(from(data) >> iterable(), positive));
+}
+
+CPP_STREAM_BENCHMARK(BM_from_views);
+CPP_STREAM_BENCHMARK_INTEGRAL(BM_int_range_views);
+CPP_STREAM_BENCHMARK(BM_iota_views);
+CPP_STREAM_BENCHMARK(BM_filter_views);
+CPP_STREAM_BENCHMARK(BM_map_views);
+CPP_STREAM_BENCHMARK(BM_pipeline_views);
+CPP_STREAM_BENCHMARK(BM_pipeline_iterable_views);
+CPP_STREAM_BENCHMARK(BM_sort_views);
+CPP_STREAM_BENCHMARK(BM_sort_arena_views);
+CPP_STREAM_BENCHMARK(BM_sort_parallel_views);
+CPP_STREAM_BENCHMARK(BM_reverse_views);
+CPP_STREAM_BENCHMARK(BM_reverse_buffered_views);
+CPP_STREAM_BENCHMARK(BM_external_sort_views);
+CPP_STREAM_BENCHMARK(BM_sort_take_views);
+CPP_STREAM_BENCHMARK_INTEGRAL(BM_flat_map_views);
+CPP_STREAM_BENCHMARK(BM_join_streams_views);
+CPP_STREAM_BENCHMARK(BM_join_streams_many_views);
+CPP_STREAM_BENCHMARK(BM_split_gather_views);
+CPP_STREAM_BENCHMARK(BM_for_each_views);
+CPP_STREAM_BENCHMARK(BM_count_views);
+CPP_STREAM_BENCHMARK(BM_count_iterable_views);
+CPP_STREAM_BENCHMARK(BM_minmax_views);
+CPP_STREAM_BENCHMARK(BM_any_match_views);
+CPP_STREAM_BENCHMARK(BM_min_views);
+CPP_STREAM_BENCHMARK(BM_max_views);
+CPP_STREAM_BENCHMARK(BM_all_match_views);
+CPP_STREAM_BENCHMARK(BM_none_match_views);
+CPP_STREAM_BENCHMARK(BM_first_views);
+CPP_STREAM_BENCHMARK(BM_element_at_views);
+CPP_STREAM_BENCHMARK(BM_collect_views);
+CPP_STREAM_BENCHMARK(BM_to_vector_views);
+CPP_STREAM_BENCHMARK(BM_into_views);
+CPP_STREAM_BENCHMARK(BM_serialize_views);
+#endif
+
+BENCHMARK_MAIN();
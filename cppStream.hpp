@@ -1,24 +1,78 @@
-// TODO references and pointers are to be rewritten.
-
 #ifndef __CPP_STREAM_HPP__
 #define __CPP_STREAM_HPP__
 #include <functional>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <stdexcept>
 #include <optional>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <tuple>
 #include <vector>
 #include <set>
+#include <unordered_map>
+#include <memory>
+#include <memory_resource>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <istream>
+#include <ostream>
+#if !defined(CPP_STREAM_NO_MMAP) && !__has_include(<sys/mman.h>)
+#define CPP_STREAM_NO_MMAP
+#endif
+#ifndef CPP_STREAM_NO_MMAP
+//file mapping
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+#if !defined(CPP_STREAM_NO_COROUTINE) && !defined(__cpp_impl_coroutine)
+#define CPP_STREAM_NO_COROUTINE
+#endif
+#ifndef CPP_STREAM_NO_COROUTINE
+//coroutine
+#include <coroutine>
+#endif
+#if __cplusplus > 201703L && __has_include(<ranges>)
+//ranges interop
+#include <ranges>
+#endif
 #ifndef CPP_STREAM_NO_TYPEINFO
 //type-erasure
 #include <typeinfo>
 #endif
+#if defined(CPP_STREAM_PROFILE) && defined(CPP_STREAM_NO_PROFILE)
+#error CPP_STREAM_PROFILE requires the profiling stages
+#endif
+#ifndef CPP_STREAM_NO_PROFILE
+//profiling
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#endif
+#ifndef CPP_STREAM_NO_PARALLEL
+//parallel
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#endif
 
 #define Buildable \
 template<typename Builder> \
-decltype(auto) operator>>(Builder builder) const& \
-{ return builder.build(*this); } \
+constexpr decltype(auto) operator>>(Builder builder) const& \
+{ return std::move(builder).build(*this); } \
 template<typename Builder> \
-decltype(auto) operator>>(Builder builder) && \
-{ return builder.build(std::move(*this)); } 
+constexpr decltype(auto) operator>>(Builder builder) && \
+{ return std::move(builder).build(std::move(*this)); } 
 
 namespace yaossg::stream { 
 
@@ -33,9 +87,13 @@ struct endless_stream_exception : stream_exception {
 	endless_stream_exception() : stream_exception("endless_stream_exception") {}
 };
 
+struct file_exception : std::runtime_error {
+	file_exception(std::string const& path) : runtime_error("file_exception: " + path) {}
+};
+
 #endif
 template<typename Stream>
-void throw_if_endless(Stream const& stream) {
+constexpr void throw_if_endless(Stream const& stream) {
 	if(stream.endless())
 #ifndef CPP_STREAM_NO_EXCEPTION
 		throw endless_stream_exception();
@@ -43,26 +101,108 @@ void throw_if_endless(Stream const& stream) {
 		std::abort();
 #endif
 }
+#ifdef CPP_STREAM_PROFILE
+// wraps every stage built by a builder into a ProfileStream reporting to std::clog
+template<typename Stage>
+auto profile_stage(Stage stage);
+#endif
+
 template<typename Pred>
 struct MakeBuilder { 
 	Pred pred;		
 	
-	explicit MakeBuilder(Pred pred) : pred(pred) {}
+	constexpr explicit MakeBuilder(Pred pred) : pred(std::move(pred)) {}
+	
+	template<typename Stream>
+	constexpr auto build(Stream&& stream) & {
+#ifdef CPP_STREAM_PROFILE
+		return profile_stage(pred(std::forward<Stream>(stream)));
+#else
+		return pred(std::forward<Stream>(stream));
+#endif
+	}
 	
 	template<typename Stream>
-	auto build(Stream const& stream) {
-		return pred(stream);
+	constexpr auto build(Stream&& stream) && {
+#ifdef CPP_STREAM_PROFILE
+		return profile_stage(std::move(pred)(std::forward<Stream>(stream)));
+#else
+		return std::move(pred)(std::forward<Stream>(stream));
+#endif
 	}
 };
 
 template<typename Pred>
-auto make_builder(Pred pred) {
-	return MakeBuilder(pred);
+constexpr auto make_builder(Pred pred) {
+	return MakeBuilder(std::move(pred));
+}
+
+// builds the stream in the second builder from the stream built in the first builder 
+template<typename First, typename Second>
+struct ChainBuilder {
+	First first;
+	Second second;
+	
+	constexpr ChainBuilder(First first, Second second) : first(std::move(first)), second(std::move(second)) {}
+	
+	template<typename Stream>
+	constexpr auto build(Stream&& stream) & {
+		return second.build(first.build(std::forward<Stream>(stream)));
+	}
+	
+	template<typename Stream>
+	constexpr auto build(Stream&& stream) && {
+		return std::move(second).build(std::move(first).build(std::forward<Stream>(stream)));
+	}
+};
+
+template<typename First, typename Second>
+constexpr auto chain_builder(First first, Second second) {
+	return ChainBuilder(std::move(first), std::move(second));
 }
 
+// constructs Stream<Upstream, Args...>(upstream, args...) 
+// specializations may merge the new stage into an upstream stage instead, see the fusions after SkipStream
+template<template<typename...>typename Stream>
+struct StageFusion {
+	template<typename Upstream, typename... Args>
+	static constexpr auto fuse(Upstream&& upstream, Args&&... args) {
+		return Stream<std::decay_t<Upstream>, std::decay_t<Args>...>(std::forward<Upstream>(upstream), std::forward<Args>(args)...);
+	}
+};
+
+template<template<typename...>typename Template, typename T>
+struct is_stage_of : std::false_type {};
+
+template<template<typename...>typename Template, typename... Args>
+struct is_stage_of<Template, Template<Args...>> : std::true_type {};
+
+template<template<typename...>typename Template, typename T>
+constexpr bool is_stage_of_v = is_stage_of<Template, std::decay_t<T>>::value;
+
+// builds the stage Stream from the upstream and args through StageFusion, the arguments are moved if it is an rvalue
+template<template<typename...>typename Stream, typename... Args>
+struct StreamFactory {
+	std::tuple<Args...> args;
+	
+	template<typename Upstream>
+	constexpr auto operator()(Upstream&& upstream) & {
+		return std::apply([&](Args&... args) {
+			return StageFusion<Stream>::fuse(std::forward<Upstream>(upstream), args...);
+		}, args);
+	}
+	
+	template<typename Upstream>
+	constexpr auto operator()(Upstream&& upstream) && {
+		return std::apply([&](Args&... args) {
+			return StageFusion<Stream>::fuse(std::forward<Upstream>(upstream), std::move(args)...);
+		}, args);
+	}
+};
+
 template<template<typename...>typename Stream, typename... Args>
-auto builder_of(Args... args) {
-	return make_builder([args...](auto stream){ return Stream<decltype(stream), Args...>(std::move(stream), args...);});
+constexpr auto builder_of(Args... args) {
+	return make_builder(StreamFactory<Stream, Args...>{std::tuple<Args...>(std::move(args)...)});
 }
 
 template<typename T>
@@ -81,6 +221,531 @@ using remove_optional_t = typename remove_optional<T>::type;
 template<typename T>
 using value_t = typename T::value_type;
 
+template<typename Stream>
+using reference_t = decltype(std::declval<Stream&>().front());
+
+// a stream declares stable_front if the references returned by front() stay valid 
+// as long as the stream and its source live, rather than until the next call to next()
+template<typename Stream, typename = void>
+struct has_stable_front : std::false_type {};
+
+template<typename Stream>
+struct has_stable_front<Stream, std::enable_if_t<Stream::stable_front>> : std::true_type {};
+
+template<typename Stream>
+constexpr bool has_stable_front_v = has_stable_front<Stream>::value && std::is_lvalue_reference_v<reference_t<Stream>>;
+
+// materializing stages keep pointers to the elements of streams with stable front(), copies otherwise
+template<typename Stream>
+using buffered_t = std::conditional_t<has_stable_front_v<Stream>, 
+	std::remove_reference_t<reference_t<Stream>>*, std::remove_cv_t<std::remove_reference_t<value_t<Stream>>>>;
+
+template<typename Stream, typename T>
+constexpr decltype(auto) to_buffered(T&& value) {
+	if constexpr(has_stable_front_v<Stream>)
+		return std::addressof(value);
+	else
+		return std::forward<T>(value);
+}
+
+template<typename Stream, typename T>
+constexpr decltype(auto) from_buffered(T& element) {
+	if constexpr(has_stable_front_v<Stream>)
+		return *element;
+	else
+		return element;
+}
+
+template<typename T>
+struct is_optional : std::false_type {};
+
+template<typename T>
+struct is_optional<std::optional<T>> : std::true_type {};
+
+template<typename T>
+constexpr bool is_optional_v = is_optional<std::remove_cv_t<std::remove_reference_t<T>>>::value;
+
+// size() is the exact count of the elements left, advance(n) equals to n calls to next() in O(1)
+// a stream supporting advance(n) without size() never ends
+template<typename Stream, typename = void>
+struct is_sized : std::false_type {};
+
+template<typename Stream>
+struct is_sized<Stream, std::void_t<decltype(std::declval<Stream const&>().size())>> : std::true_type {};
+
+template<typename Stream>
+constexpr bool is_sized_v = is_sized<Stream>::value;
+
+template<typename Stream, typename = void>
+struct is_random_access : std::false_type {};
+
+template<typename Stream>
+struct is_random_access<Stream, std::void_t<decltype(std::declval<Stream&>().advance(size_t()))>> : std::true_type {};
+
+template<typename Stream>
+constexpr bool is_random_access_v = is_random_access<Stream>::value;
+
+template<typename Iterator>
+constexpr bool is_random_access_iterator_v = std::is_base_of_v<std::random_access_iterator_tag, 
+	typename std::iterator_traits<Iterator>::iterator_category>;
+
+// demand(n) tells a stream that no more than n elements will be pulled from it
+template<typename Stream, typename = void>
+struct has_demand : std::false_type {};
+
+template<typename Stream>
+struct has_demand<Stream, std::void_t<decltype(std::declval<Stream&>().demand(size_t()))>> : std::true_type {};
+
+template<typename Stream>
+constexpr void hint_demand(Stream& stream, size_t n) {
+	if constexpr(has_demand<Stream>::value)
+		stream.demand(n);
+}
+
+// the demand on the upstream of a stage pulling factor elements for each of its own and extra more, 
+// saturated since size_t(-1) stands for no demand
+constexpr size_t scale_demand(size_t n, size_t factor, size_t extra = 0) {
+	if(factor && n > (size_t(-1) - extra) / factor)
+		return size_t(-1);
+	return n * factor + extra;
+}
+
+// a stream caching its front() may provide take_front() to move the cached element out
+template<typename Stream, typename = void>
+struct has_take_front : std::false_type {};
+
+template<typename Stream>
+struct has_take_front<Stream, std::void_t<decltype(std::declval<Stream&>().take_front())>> : std::true_type {};
+
+template<typename Stream>
+constexpr decltype(auto) take_front(Stream& stream) {
+	if constexpr(has_take_front<Stream>::value)
+		return stream.take_front();
+	else
+		return stream.front();
+}
+
+template<typename Container, typename = void>
+struct has_reserve : std::false_type {};
+
+template<typename Container>
+struct has_reserve<Container, std::void_t<decltype(std::declval<Container&>().reserve(size_t()))>> : std::true_type {};
+
+template<typename Stream, typename Sink, typename = void>
+struct has_for_each_until : std::false_type {};
+
+template<typename Stream, typename Sink>
+struct has_for_each_until<Stream, Sink, 
+	std::void_t<decltype(std::declval<Stream&>().for_each_until(std::declval<Sink&>()))>> : std::true_type {};
+
+// internal iteration: pushes the remaining elements of stream into sink until sink returns false
+// returns false if sink stopped it, true if the stream is exhausted
+// the stream may be continued with next() afterwards, but front() is unspecified until then
+template<typename Stream, typename Sink>
+constexpr bool push_until(Stream& stream, Sink&& sink) {
+	if constexpr(has_for_each_until<Stream, Sink>::value) {
+		return stream.for_each_until(sink);
+	} else {
+		while(stream.next())
+			if(!std::invoke(sink, stream.front()))
+				return false;
+		return true;
+	}
+}
+
+// block iteration: for_each_block(sink) pushes the remaining elements as arrays through 
+// sink(T const* data, size_t size) until sink returns false, the stream is consumed afterwards
+// IteratorStream over contiguous iterators yields its range as a block, MapStream and TakeStream forward blocks
+constexpr size_t block_size = 256;
+
+struct BlockSinkProbe {
+	template<typename T>
+	bool operator()(T const*, size_t) const;
+};
+
+template<typename Stream, typename = void>
+struct has_for_each_block : std::false_type {};
+
+template<typename Stream>
+struct has_for_each_block<Stream, 
+	std::void_t<decltype(std::declval<Stream&>().for_each_block(std::declval<BlockSinkProbe&>()))>> : std::true_type {};
+
+template<typename Stream>
+constexpr bool has_for_each_block_v = has_for_each_block<Stream>::value;
+
+// elements which can be stored into the block buffer of a stage
+template<typename T>
+constexpr bool is_blockable_v = std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T>;
+
+template<typename Iterator>
+constexpr bool is_contiguous_iterator_v = 
+#ifdef __cpp_lib_concepts
+	std::contiguous_iterator<Iterator>;
+#else
+	std::is_pointer_v<Iterator>;
+#endif
+
+template<typename Stream, typename = void>
+struct is_stream : std::false_type {};
+
+template<typename Stream>
+struct is_stream<Stream, std::void_t<decltype(std::declval<Stream&>().next()), 
+	decltype(std::declval<Stream const&>().endless())>> : std::true_type {};
+
+template<typename Stream, typename = void>
+struct has_stream_member : std::false_type {};
+
+template<typename Stream>
+struct has_stream_member<Stream, std::void_t<decltype(std::declval<Stream const&>().stream)>> : std::true_type {};
+
+template<typename Stream, typename = void>
+struct has_streams_member : std::false_type {};
+
+template<typename Stream>
+struct has_streams_member<Stream, std::void_t<decltype(std::declval<Stream const&>().streams)>> : std::true_type {};
+
+template<typename T>
+struct is_tuple : std::false_type {};
+
+template<typename... Args>
+struct is_tuple<std::tuple<Args...>> : std::true_type {};
+
+// buffering stages allocate from the memory resource of the nearest ArenaStream upstream, the default resource otherwise
+template<typename Stream, typename = void>
+struct has_resource : std::false_type {};
+
+template<typename Stream>
+struct has_resource<Stream, std::void_t<decltype(std::declval<Stream const&>().resource())>> : std::true_type {};
+
+template<typename Stream>
+std::pmr::memory_resource* memory_resource_of(Stream const& stream) {
+	if constexpr(has_resource<Stream>::value)
+		return stream.resource();
+	else if constexpr(has_stream_member<Stream>::value)
+		return memory_resource_of(stream.stream);
+	else
+		return std::pmr::get_default_resource();
+}
+
+// the stream itself, with arena as the memory resource of the stages after it
+template<typename Stream>
+struct ArenaStream : Stream {
+	std::pmr::memory_resource* arena;
+	
+	ArenaStream(Stream stream, std::pmr::memory_resource* arena)
+		: Stream(std::move(stream)), arena(arena) {}
+	
+	std::pmr::memory_resource* resource() const {
+		return arena;
+	}
+	
+	Buildable;
+};
+
+// sorts runs of stable_sort_run elements by insertion, the merge passes of the merge sorts start from them
+constexpr size_t stable_sort_run = 32;
+
+template<typename Iterator, typename Less>
+void sort_runs_in(Iterator begin, size_t n, Less& less) {
+	for(size_t i = 0; i < n; i += stable_sort_run) 
+		for(auto j = begin + i + 1, last = begin + std::min(i + stable_sort_run, n); j < last; ++j)
+			std::rotate(std::upper_bound(begin + i, j, *j, less), j, j + 1);
+}
+
+// std::merge on move iterators would compare rvalues
+template<typename In, typename Out, typename Less>
+Out merge_moving(In first, In middle, In last, Out out, Less& less) {
+	for(auto second = middle; first != middle || second != last;)
+		*out++ = first == middle || (second != last && less(*second, *first)) ? std::move(*second++) : std::move(*first++);
+	return out;
+}
+
+// std::stable_sort takes its buffer from operator new, a bottom-up merge sort takes it from resource instead
+template<typename Iterator, typename Less>
+void stable_sort_in(Iterator begin, Iterator end, Less less, std::pmr::memory_resource* resource) {
+	if(resource == std::pmr::new_delete_resource()) {
+		std::stable_sort(begin, end, less);
+		return;
+	}
+	size_t n = end - begin;
+	sort_runs_in(begin, n, less);
+	if(n <= stable_sort_run)
+		return;
+	std::pmr::vector<typename std::iterator_traits<Iterator>::value_type> buffer(resource);
+	buffer.reserve(n);
+	bool in_buffer = false;
+	for(size_t width = stable_sort_run; width < n; width *= 2, in_buffer = !in_buffer) {
+		for(size_t i = 0; i < n; i += 2 * width) {
+			size_t middle = std::min(i + width, n), last = std::min(i + 2 * width, n);
+			if(in_buffer)
+				merge_moving(buffer.begin() + i, buffer.begin() + middle, buffer.begin() + last, begin + i, less);
+			else if(buffer.size() < n)
+				merge_moving(begin + i, begin + middle, begin + last, std::back_inserter(buffer), less);
+			else
+				merge_moving(begin + i, begin + middle, begin + last, buffer.begin() + i, less);
+		}
+	}
+	if(in_buffer)
+		std::move(buffer.begin(), buffer.end(), begin);
+}
+
+// the same merge sort through scratch, constructed elements as many as [begin, end), so that nothing is allocated
+template<typename Iterator, typename Scratch, typename Less>
+void stable_sort_with(Iterator begin, Iterator end, Scratch scratch, Less less) {
+	size_t n = end - begin;
+	sort_runs_in(begin, n, less);
+	bool in_scratch = false;
+	for(size_t width = stable_sort_run; width < n; width *= 2, in_scratch = !in_scratch) {
+		for(size_t i = 0; i < n; i += 2 * width) {
+			size_t middle = std::min(i + width, n), last = std::min(i + 2 * width, n);
+			if(in_scratch)
+				merge_moving(scratch + i, scratch + middle, scratch + last, begin + i, less);
+			else
+				merge_moving(begin + i, begin + middle, begin + last, scratch + i, less);
+		}
+	}
+	if(in_scratch)
+		std::move(scratch, scratch + n, begin);
+}
+
+template<typename T, typename Less>
+void stable_sort_in(std::pmr::vector<T>& data, Less less) {
+	stable_sort_in(data.begin(), data.end(), std::move(less), data.get_allocator().resource());
+}
+
+#ifndef CPP_STREAM_NO_PROFILE
+// the statistics of a profiled stage, reported as a tree rooted at the most downstream stage when the root is destroyed
+// the counters are shared by the slices of the stage running on the threads of a pool
+struct ProfileNode {
+	std::string name;
+	std::atomic<size_t> calls{0}, elements{0}, peak{0};
+	std::atomic<std::chrono::nanoseconds::rep> nanoseconds{0};
+	std::vector<std::shared_ptr<ProfileNode>> upstreams;
+	std::ostream* out;
+	bool has_downstream = false;
+	
+	ProfileNode(std::string name, std::ostream* out) : name(std::move(name)), out(out) {}
+	
+	ProfileNode(ProfileNode const&) = delete;
+	ProfileNode& operator=(ProfileNode const&) = delete;
+	
+	~ProfileNode() {
+		if(!has_downstream && out)
+			report(*out);
+	}
+	
+	void count(size_t n) {
+		elements.fetch_add(n, std::memory_order_relaxed);
+	}
+	
+	void spend(std::chrono::nanoseconds duration) {
+		nanoseconds.fetch_add(duration.count(), std::memory_order_relaxed);
+	}
+	
+	void sample(size_t buffered) {
+		size_t current = peak.load(std::memory_order_relaxed);
+		while(current < buffered && !peak.compare_exchange_weak(current, buffered, std::memory_order_relaxed));
+	}
+	
+	std::chrono::nanoseconds time() const {
+		return std::chrono::nanoseconds(nanoseconds.load(std::memory_order_relaxed));
+	}
+	
+	// one line each stage, time is spent in the stage and its upstreams, self excludes the profiled upstreams
+	void report(std::ostream& out, size_t depth = 0) const {
+		auto ms = [](std::chrono::nanoseconds time) { return std::chrono::duration<double, std::milli>(time).count(); };
+		out << std::string(depth * 2, ' ') << name << ": out " << elements;
+		if(calls)
+			out << ", next " << calls;
+		out << ", time " << ms(time()) << "ms";
+		if(!upstreams.empty()) {
+			size_t in = 0;
+			auto self = time();
+			for(auto const& upstream : upstreams)
+				in += upstream->elements, self -= upstream->time();
+			out << ", self " << ms(self) << "ms, in " << in;
+			if(in)
+				out << ", selectivity " << 100.0 * elements / in << "%";
+		}
+		if(peak)
+			out << ", peak buffer " << peak;
+		out << '\n';
+		for(auto const& upstream : upstreams)
+			upstream->report(out, depth + 1);
+	}
+};
+
+// buffered() is the count of the elements a materializing stage holds now
+template<typename Stream, typename = void>
+struct has_buffered : std::false_type {};
+
+template<typename Stream>
+struct has_buffered<Stream, std::void_t<decltype(std::declval<Stream const&>().buffered())>> : std::true_type {};
+
+// the unqualified name of the template of Stage
+template<typename Stage>
+std::string stage_name() {
+#if defined(_MSC_VER) && !defined(__clang__)
+	std::string_view name = __FUNCSIG__, prefix = "stage_name<";
+#else
+	std::string_view name = __PRETTY_FUNCTION__, prefix = "Stage = ";
+#endif
+	if(size_t start = name.find(prefix); start != name.npos)
+		name.remove_prefix(start + prefix.size());
+	name = name.substr(0, name.find_first_of("<;]>"));
+	for(std::string_view qualifier : {"struct ", "class ", "yaossg::stream::"})
+		if(name.substr(0, qualifier.size()) == qualifier)
+			name.remove_prefix(qualifier.size());
+	return std::string(name);
+}
+
+template<typename Stream>
+struct ProfileStream;
+
+template<typename Stream>
+void link_upstream_profiles(Stream const& stream, ProfileNode& node);
+
+template<typename Stream>
+void link_upstream_profiles(ProfileStream<Stream> const& stream, ProfileNode& node) {
+	node.upstreams.push_back(stream.node);
+	stream.node->has_downstream = true;
+}
+
+template<typename Streams, size_t... I>
+void link_upstream_profiles(Streams const& streams, ProfileNode& node, std::index_sequence<I...>) {
+	(link_upstream_profiles(std::get<I>(streams), node), ...);
+}
+
+// looks for the nearest profiled stages through the stream or streams members
+template<typename Stream>
+void link_upstream_profiles(Stream const& stream, ProfileNode& node) {
+	if constexpr(is_optional<Stream>::value) {
+		if(stream)
+			link_upstream_profiles(*stream, node);
+	} else if constexpr(!std::is_class_v<Stream>) {
+	} else if constexpr(has_stream_member<Stream>::value) {
+		link_upstream_profiles(stream.stream, node);
+	} else if constexpr(has_streams_member<Stream>::value) {
+		using Streams = std::decay_t<decltype(stream.streams)>;
+		if constexpr(is_tuple<Streams>::value)
+			link_upstream_profiles(stream.streams, node, std::make_index_sequence<std::tuple_size_v<Streams>>{});
+		else
+			for(auto const& upstream : stream.streams)
+				link_upstream_profiles(upstream, node);
+	}
+}
+
+// forwards the stream and records its element count, the calls to next(), the time spent pulling or pushing it 
+// and the peak of buffered() of the stream, the time spent by the downstream sinks is not counted
+template<typename Stream>
+struct ProfileStream {
+	using value_type = value_t<Stream>;
+	static constexpr bool stable_front = has_stable_front_v<Stream>;
+	
+	Stream stream;
+	std::shared_ptr<ProfileNode> node;
+	
+	ProfileStream(Stream stream, std::string name, std::ostream* out)
+		: stream(std::move(stream)), node(std::make_shared<ProfileNode>(std::move(name), out)) {
+		link_upstream_profiles(this->stream, *node);
+	}
+	
+	// a slice or the reversal of a profiled stage reports to the same node
+	ProfileStream(Stream stream, std::shared_ptr<ProfileNode> node)
+		: stream(std::move(stream)), node(std::move(node)) {}
+	
+	decltype(auto) front() {
+		return stream.front();
+	}
+	
+	bool next() {
+		auto start = std::chrono::steady_clock::now();
+		bool result = stream.next();
+		node->spend(std::chrono::steady_clock::now() - start);
+		node->calls.fetch_add(1, std::memory_order_relaxed);
+		node->count(result);
+		sample();
+		return result;
+	}
+	
+	template<typename Sink>
+	bool for_each_until(Sink&& sink) {
+		auto last = std::chrono::steady_clock::now();
+		bool result = push_until(stream, [&](auto&& value) {
+			node->spend(std::chrono::steady_clock::now() - last);
+			node->count(1);
+			sample();
+			bool accepted = std::invoke(sink, std::forward<decltype(value)>(value));
+			last = std::chrono::steady_clock::now();
+			return accepted;
+		});
+		node->spend(std::chrono::steady_clock::now() - last);
+		sample();
+		return result;
+	}
+	
+	template<typename Sink, typename S = Stream, typename = std::enable_if_t<has_for_each_block_v<S>>>
+	bool for_each_block(Sink&& sink) {
+		auto last = std::chrono::steady_clock::now();
+		bool result = stream.for_each_block([&](auto const* data, size_t size) {
+			node->spend(std::chrono::steady_clock::now() - last);
+			node->count(size);
+			bool accepted = std::invoke(sink, data, size);
+			last = std::chrono::steady_clock::now();
+			return accepted;
+		});
+		node->spend(std::chrono::steady_clock::now() - last);
+		return result;
+	}
+	
+	template<typename S = Stream, typename = std::enable_if_t<has_take_front<S>::value>>
+	decltype(auto) take_front() {
+		return stream.take_front();
+	}
+	
+	template<typename S = Stream, typename = std::enable_if_t<is_sized_v<S>>>
+	size_t size() const {
+		return stream.size();
+	}
+	
+	template<typename S = Stream, typename = std::enable_if_t<is_random_access_v<S>>>
+	void advance(size_t n) {
+		stream.advance(n);
+	}
+	
+	template<typename S = Stream, typename = std::enable_if_t<has_demand<S>::value>>
+	void demand(size_t n) {
+		stream.demand(n);
+	}
+	
+	bool endless() const {
+		return stream.endless();
+	}
+	
+	Buildable;
+	
+private:
+	void sample() {
+		if constexpr(has_buffered<Stream>::value)
+			node->sample(stream.buffered());
+	}
+};
+
+template<typename T>
+struct is_profile_stream : std::false_type {};
+
+template<typename Stream>
+struct is_profile_stream<ProfileStream<Stream>> : std::true_type {};
+
+template<typename Stage>
+auto profile_stage(Stage stage) {
+	if constexpr(is_stream<Stage>::value && !is_profile_stream<Stage>::value)
+		return ProfileStream<Stage>(std::move(stage), stage_name<Stage>(), &std::clog);
+	else 
+		return stage;
+}
+#endif
+
 
 template<typename T>
 struct EmptyStream {
@@ -88,11 +753,16 @@ struct EmptyStream {
 	
 	value_type front() {} // UB if invokes it
 	
-	bool next() {
+	constexpr bool next() {
 		return false;
 	}
 	
-	bool endless() const {
+	template<typename Sink>
+	constexpr bool for_each_until(Sink&&) {
+		return true;
+	}
+	
+	constexpr bool endless() const {
 		return false;
 	}
 	
@@ -102,21 +772,30 @@ struct EmptyStream {
 template<typename First>
 struct EndlessIteratorStream {
 	using value_type = value_t<std::iterator_traits<First>>;
+	static constexpr bool stable_front = std::is_base_of_v<std::forward_iterator_tag, 
+		typename std::iterator_traits<First>::iterator_category>;
 	
 	First current, upcoming;
 	
-	EndlessIteratorStream(First first)
+	constexpr EndlessIteratorStream(First first)
 		: current(first), upcoming(first) {}
 	
-	decltype(auto) front() {
+	constexpr decltype(auto) front() {
 		return *current;
 	}
 	
-	bool next() {
+	constexpr bool next() {
 		return current = upcoming++, true;
 	}
 	
-	bool endless() const {
+	template<typename Sink>
+	constexpr bool for_each_until(Sink&& sink) {
+		for(;;)
+			if(!std::invoke(sink, *upcoming++))
+				return false;
+	}
+	
+	constexpr bool endless() const {
 		return true;
 	}
 	
@@ -126,23 +805,53 @@ struct EndlessIteratorStream {
 template<typename First, typename Last>
 struct IteratorStream {
 	using value_type = value_t<std::iterator_traits<First>>;
+	static constexpr bool stable_front = std::is_base_of_v<std::forward_iterator_tag, 
+		typename std::iterator_traits<First>::iterator_category>;
 	
 	First current, upcoming;
 	Last last;
 	bool unchecked;
 	
-	IteratorStream(First first, Last last, bool unchecked)
+	constexpr IteratorStream(First first, Last last, bool unchecked)
 		: current(first), upcoming(first), last(last), unchecked(unchecked) {}
 	
-	decltype(auto) front() {
+	constexpr decltype(auto) front() {
 		return *current;
 	}
 	
-	bool next() {
+	constexpr bool next() {
 		return upcoming == last ? false : (current = upcoming++, true);
 	}
 	
-	bool endless() const {
+	template<typename Sink>
+	constexpr bool for_each_until(Sink&& sink) {
+		for(auto it = upcoming; it != last; ++it)
+			if(!std::invoke(sink, *it))
+				return upcoming = ++it, false;
+		return upcoming = last, true;
+	}
+	
+	template<typename Sink, typename F = First, typename = std::enable_if_t<is_contiguous_iterator_v<F> && std::is_same_v<F, Last>>>
+	constexpr bool for_each_block(Sink&& sink) {
+		if(upcoming == last)
+			return true;
+		value_type const* data = std::addressof(*upcoming);
+		size_t size = last - upcoming;
+		upcoming = last;
+		return std::invoke(sink, data, size);
+	}
+	
+	template<typename F = First, typename = std::enable_if_t<is_random_access_iterator_v<F> && std::is_same_v<F, Last>>>
+	constexpr size_t size() const {
+		return last - upcoming;
+	}
+	
+	template<typename F = First, typename = std::enable_if_t<is_random_access_iterator_v<F> && std::is_same_v<F, Last>>>
+	constexpr void advance(size_t n) {
+		upcoming += std::min(n, size());
+	}
+	
+	constexpr bool endless() const {
 		return unchecked;
 	}
 	
@@ -155,18 +864,29 @@ struct IntegerStream {
 	
 	IntType current, step;
 	
-	IntegerStream(IntType first, IntType step = 1) 
+	constexpr IntegerStream(IntType first, IntType step = 1) 
 		: current(first - step), step(step) {}
 	
-	decltype(auto) front() {
+	constexpr decltype(auto) front() {
 		return current;
 	}
 	
-	bool next() {
+	constexpr bool next() {
 		return current += step, true;
 	}
 	
-	bool endless() const {
+	template<typename Sink>
+	constexpr bool for_each_until(Sink&& sink) {
+		for(IntType value = current;;)
+			if(!std::invoke(sink, value += step))
+				return current = value, false;
+	}
+	
+	constexpr void advance(size_t n) {
+		current += step * IntType(n);
+	}
+	
+	constexpr bool endless() const {
 		return true;
 	}
 	
@@ -180,958 +900,5474 @@ struct GenerateStream {
 	Getter getter;
 	std::optional<value_type> cache;
 	
-	GenerateStream(Getter getter) 
-		: getter(getter) {}
+	constexpr GenerateStream(Getter getter) 
+		: getter(std::move(getter)) {}
 	
-	decltype(auto) front() {
+	constexpr decltype(auto) front() {
 		return *cache;
 	}
 	
-	bool next() {
-		return cache = std::invoke(getter), true;
+	constexpr value_type take_front() {
+		return *std::move(cache);
 	}
 	
-	bool endless() const {
+	constexpr bool next() {
+		return cache.emplace(std::invoke(getter)), true;
+	}
+	
+	template<typename Sink>
+	constexpr bool for_each_until(Sink&& sink) {
+		for(;;)
+			if(!std::invoke(sink, std::invoke(getter)))
+				return false;
+	}
+	
+	constexpr bool endless() const {
 		return true;
 	}
 	
 	Buildable;
 };
 
-template<typename Stream, typename Pred>
-struct FilterStream {
-	using value_type = value_t<Stream>;
-	
-	Stream stream;
-	Pred pred;
-	
-	FilterStream(Stream stream, Pred pred)
-		: stream(stream), pred(pred) {}
+#ifndef CPP_STREAM_NO_COROUTINE
+// frames of coroutines declared as f(std::allocator_arg_t, std::pmr::memory_resource*, ...) 
+// are allocated from that resource, e.g. a std::pmr::unsynchronized_pool_resource reusing them
+struct CoroutineFrame {
+	static size_t header(size_t size) {
+		return (size + alignof(std::pmr::memory_resource*) - 1) / alignof(std::pmr::memory_resource*) 
+			* alignof(std::pmr::memory_resource*);
+	}
 	
-	decltype(auto) front() {
-		return stream.front();
+	static void* allocate(size_t size, std::pmr::memory_resource* resource) {
+		size_t offset = header(size);
+		void* frame = resource->allocate(offset + sizeof(resource), alignof(std::max_align_t));
+		std::memcpy(static_cast<char*>(frame) + offset, &resource, sizeof(resource));
+		return frame;
 	}
 	
-	bool next() {
-		while(stream.next())
-			if(std::invoke(pred, stream.front()))
-				return true;
-		return false;
+	static void* operator new(size_t size) {
+		return allocate(size, std::pmr::new_delete_resource());
 	}
 	
-	bool endless() const {
-		return stream.endless();
+	template<typename... Args>
+	static void* operator new(size_t size, std::allocator_arg_t, std::pmr::memory_resource* resource, Args const&...) {
+		return allocate(size, resource ? resource : std::pmr::new_delete_resource());
 	}
 	
-	Buildable;
+	static void operator delete(void* frame, size_t size) {
+		size_t offset = header(size);
+		std::pmr::memory_resource* resource;
+		std::memcpy(&resource, static_cast<char*>(frame) + offset, sizeof(resource));
+		resource->deallocate(frame, offset + sizeof(resource), alignof(std::max_align_t));
+	}
 };
 
-template<typename Stream, typename Pred>
-struct MapStream {
-	using value_type = remove_optional_t<std::remove_cv_t<std::invoke_result_t<Pred, value_t<Stream>>>>;
+// co_yield of an rvalue hands it out without copy, lvalues are copied into the promise
+template<typename T>
+struct YieldedValue {
+	T* current = nullptr;
+	std::optional<T> copy;
+#ifndef CPP_STREAM_NO_EXCEPTION
+	std::exception_ptr error;
+#endif
 	
-	Stream stream;
-	Pred pred;
-	std::optional<value_type> cache_value;
-
-	MapStream(Stream stream, Pred pred)
-		: stream(stream), pred(pred) {}
-
-	decltype(auto) front() {
-		return *cache_value;
-	}
-
-	bool next() {
-		while(stream.next())
-			if(cache_value = std::invoke(pred, stream.front()))
-				return true;
-		return false;
+	template<typename U>
+	void yield(U&& value) {
+		if constexpr(std::is_same_v<U, T>)
+			current = std::addressof(value);
+		else
+			current = std::addressof(copy.emplace(std::forward<U>(value)));
 	}
 	
-	bool endless() const {
-		return stream.endless();
+	void return_void() noexcept {}
+	
+	void unhandled_exception() {
+#ifndef CPP_STREAM_NO_EXCEPTION
+		error = std::current_exception();
+#else
+		std::abort();
+#endif
 	}
 	
-	Buildable;
+	void rethrow_if_failed() {
+#ifndef CPP_STREAM_NO_EXCEPTION
+		if(error)
+			std::rethrow_exception(std::exchange(error, nullptr));
+#endif
+	}
 };
 
-template<typename Stream>
-struct TakeStream {
-	using value_type = value_t<Stream>;
-	
-	Stream stream;
-	size_t count;
+// a synchronous coroutine producing elements with co_yield, see from_generator
+template<typename T>
+class Generator {
+public:
+	using value_type = std::remove_cv_t<std::remove_reference_t<T>>;
 	
-	TakeStream(Stream stream, size_t count)
-		: stream(stream), count(count + 1){}
+	struct promise_type : CoroutineFrame, YieldedValue<value_type> {
+		Generator get_return_object() {
+			return Generator(std::coroutine_handle<promise_type>::from_promise(*this));
+		}
 		
-	decltype(auto) front() {
-		return stream.front();
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		
+		std::suspend_always final_suspend() noexcept { return {}; }
+		
+		template<typename U>
+		std::suspend_always yield_value(U&& value) {
+			this->yield(std::forward<U>(value));
+			return {};
+		}
+		
+		// use AsyncGenerator to co_await
+		template<typename U>
+		std::suspend_never await_transform(U&&) = delete;
+	};
+	
+	Generator(Generator&& other) noexcept 
+		: handle(std::exchange(other.handle, nullptr)) {}
+	
+	Generator& operator=(Generator other) noexcept {
+		std::swap(handle, other.handle);
+		return *this;
 	}
 	
-	bool next() {
-		return count && --count != 0 && stream.next();
+	~Generator() {
+		if(handle)
+			handle.destroy();
 	}
 	
-	bool endless() const {
-		return false;
+	value_type& front() {
+		return *handle.promise().current;
 	}
 	
-	Buildable;
+	bool next() {
+		if(handle.done())
+			return false;
+		handle.resume();
+		if(handle.done())
+			return handle.promise().rethrow_if_failed(), false;
+		return true;
+	}
+	
+private:
+	std::coroutine_handle<promise_type> handle;
+	
+	explicit Generator(std::coroutine_handle<promise_type> handle) : handle(handle) {}
 };
 
-template<typename Stream>
-struct SkipStream {
-	using value_type = value_t<Stream>;
+template<typename T>
+struct GeneratorStream {
+	using value_type = value_t<Generator<T>>;
 	
-	Stream stream;
-	size_t count;
+	Generator<T> generator;
+	bool unchecked;
+	
+	GeneratorStream(Generator<T> generator, bool unchecked)
+		: generator(std::move(generator)), unchecked(unchecked) {}
 	
-	SkipStream(Stream stream, size_t count)
-		: stream(stream), count(count + 1) {}
-		
 	decltype(auto) front() {
-		return stream.front();
+		return generator.front();
 	}
 	
 	bool next() {
-		while(count && --count != 0 && stream.next());
-		return stream.next();
+		return generator.next();
 	}
 	
 	bool endless() const {
-		return stream.endless();
+		return unchecked;
 	}
 	
 	Buildable;
 };
 
-template<typename Stream, typename Pred>
-struct TakeWhileStream {
-	using value_type = value_t<Stream>;
-	
-	Stream stream;
-	Pred pred;
-	bool remaining;
+// a coroutine which may co_await while producing elements with co_yield, consumed from another coroutine:
+//     while(co_await generator.next()) 
+//         use(generator.front());
+// next() resumes the producer, which resumes the consumer when it yields or finishes
+template<typename T>
+class AsyncGenerator {
+public:
+	using value_type = std::remove_cv_t<std::remove_reference_t<T>>;
 	
-	TakeWhileStream(Stream stream, Pred pred)
-		: stream(stream), pred(pred), remaining(true) {}
+	struct promise_type : CoroutineFrame, YieldedValue<value_type> {
+		std::coroutine_handle<> consumer;
 		
-	decltype(auto) front() {
-		return stream.front();
+		struct Transfer {
+			bool await_ready() noexcept { return false; }
+			
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept { 
+				return handle.promise().consumer; 
+			}
+			
+			void await_resume() noexcept {}
+		};
+		
+		AsyncGenerator get_return_object() {
+			return AsyncGenerator(std::coroutine_handle<promise_type>::from_promise(*this));
+		}
+		
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		
+		Transfer final_suspend() noexcept { return {}; }
+		
+		template<typename U>
+		Transfer yield_value(U&& value) {
+			this->yield(std::forward<U>(value));
+			return {};
+		}
+	};
+	
+	AsyncGenerator(AsyncGenerator&& other) noexcept 
+		: handle(std::exchange(other.handle, nullptr)) {}
+	
+	AsyncGenerator& operator=(AsyncGenerator other) noexcept {
+		std::swap(handle, other.handle);
+		return *this;
 	}
 	
-	bool next() {
-		return remaining && (remaining = (stream.next() && std::invoke(pred, stream.front())));
+	~AsyncGenerator() {
+		if(handle)
+			handle.destroy();
 	}
 	
-	bool endless() const {
-		return stream.endless(); // depending on stream as well as pred
+	value_type& front() {
+		return *handle.promise().current;
 	}
 	
-	Buildable;
+	// co_await next() is true if front() holds the next element
+	auto next() {
+		struct Next {
+			std::coroutine_handle<promise_type> handle;
+			
+			bool await_ready() noexcept { 
+				return handle.done(); 
+			}
+			
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<> consumer) noexcept {
+				handle.promise().consumer = consumer;
+				return handle;
+			}
+			
+			bool await_resume() {
+				if(handle.done())
+					return handle.promise().rethrow_if_failed(), false;
+				return true;
+			}
+		};
+		return Next{handle};
+	}
+	
+private:
+	std::coroutine_handle<promise_type> handle;
+	
+	explicit AsyncGenerator(std::coroutine_handle<promise_type> handle) : handle(handle) {}
 };
+#endif
 
-template<typename Stream, typename Pred>
-struct SkipWhileStream {
-	using value_type = value_t<Stream>;
+// a read-only view of a whole file, mapped into memory where mmap is available
+class MappedFile {
+public:
+	explicit MappedFile(std::string const& path) {
+#ifndef CPP_STREAM_NO_MMAP
+		int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if(fd < 0)
+			fail(path);
+		struct stat status;
+		if(::fstat(fd, &status) != 0)
+			::close(fd), fail(path);
+		length = size_t(status.st_size);
+		if(length) {
+			void* mapped = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+			if(mapped == MAP_FAILED)
+				::close(fd), fail(path);
+			::madvise(mapped, length, MADV_SEQUENTIAL);
+			begin = static_cast<char const*>(mapped);
+		}
+		::close(fd);
+#else
+		std::ifstream in(path, std::ios::binary | std::ios::ate);
+		if(!in)
+			fail(path);
+		buffer.resize(size_t(in.tellg()));
+		in.seekg(0);
+		if(!in.read(buffer.data(), std::streamsize(buffer.size())))
+			fail(path);
+		begin = buffer.data();
+		length = buffer.size();
+#endif
+	}
 	
-	Stream stream;
-	Pred pred;
-	bool remaining;
+	MappedFile(MappedFile const&) = delete;
+	MappedFile& operator=(MappedFile const&) = delete;
 	
-	SkipWhileStream(Stream stream, Pred pred)
-		: stream(stream), pred(pred), remaining(true){}
-		
-	decltype(auto) front() {
-		return stream.front();
+	~MappedFile() {
+#ifndef CPP_STREAM_NO_MMAP
+		if(length)
+			::munmap(const_cast<char*>(begin), length);
+#endif
 	}
 	
-	bool next() {
-		while(remaining) {
-			if(!stream.next()) 
-				return remaining = false;
-			if(!std::invoke(pred, stream.front()))
-				return !(remaining = false);
-		}
-		return stream.next();
+	char const* data() const {
+		return begin;
 	}
 	
-	bool endless() const {
-		return stream.endless();
+	size_t size() const {
+		return length;
 	}
 	
-	Buildable;
+private:
+	char const* begin = nullptr;
+	size_t length = 0;
+#ifdef CPP_STREAM_NO_MMAP
+	std::vector<char> buffer;
+#endif
+	
+	[[noreturn]] static void fail([[maybe_unused]] std::string const& path) {
+#ifndef CPP_STREAM_NO_EXCEPTION
+		throw file_exception(path);
+#else
+		std::abort();
+#endif
+	}
 };
 
-template<typename Stream, typename Compare>
-struct SortStream {
-	using value_type = value_t<Stream>;
-	
-	Stream stream;
-	Compare compare;
-	std::vector<std::remove_cv_t<std::remove_reference_t<value_type>>> sorted;
-	size_t current;
+// the records of a buffer separated by delimiter, the views are valid as long as the stream lives
+// a trailing delimiter does not start an empty record, '\r' before the delimiter is dropped if strip_cr
+struct DelimitedStream {
+	using value_type = std::string_view;
+	
+	std::shared_ptr<MappedFile const> file;
+	char const* upcoming;
+	char const* last;
+	std::string_view current;
+	char delimiter;
+	bool strip_cr;
+	
+	DelimitedStream(std::shared_ptr<MappedFile const> file, char delimiter, bool strip_cr)
+		: file(std::move(file)), delimiter(delimiter), strip_cr(strip_cr) {
+		upcoming = this->file->data();
+		last = upcoming + this->file->size();
+	}
 	
-	SortStream(Stream stream, Compare compare) 
-		: stream(stream), compare(compare), current(0) {}
+	DelimitedStream(std::string_view text, char delimiter, bool strip_cr)
+		: upcoming(text.data()), last(text.data() + text.size()), delimiter(delimiter), strip_cr(strip_cr) {}
 	
 	decltype(auto) front() {
-		return sorted[current - 1];
+		return current;
 	}
 	
 	bool next() {
-		if(!current++) {
-			while(stream.next())
-				sorted.push_back(stream.front());
-			std::stable_sort(sorted.begin(), sorted.end(), compare);
-		}
-		return current - 1 < sorted.size();
+		if(upcoming == last)
+			return false;
+		current = record();
+		return true;
+	}
+	
+	template<typename Sink>
+	bool for_each_until(Sink&& sink) {
+		while(upcoming != last)
+			if(!std::invoke(sink, record()))
+				return false;
+		return true;
 	}
 	
 	bool endless() const {
-		return stream.endless();
+		return false;
 	}
 	
 	Buildable;
+	
+private:
+	std::string_view record() {
+		char const* first = upcoming;
+		char const* end = static_cast<char const*>(std::memchr(first, delimiter, last - first));
+		upcoming = end ? end + 1 : (end = last);
+		if(strip_cr && end != first && end[-1] == '\r')
+			--end;
+		return std::string_view(first, end - first);
+	}
 };
 
-template<typename Stream>
-struct ReverseStream {
-	using value_type = value_t<Stream>;
-	
-	Stream stream;
-	std::vector<std::remove_cv_t<std::remove_reference_t<value_type>>> reversed;
-	size_t current;
+// fixed-size records of trivially copyable T laid out in a file, a partial trailing record is ignored
+template<typename T>
+struct MappedStream : IteratorStream<T const*, T const*> {
+	static_assert(std::is_trivially_copyable_v<T>, "records must be trivially copyable");
+	static_assert(alignof(T) <= alignof(std::max_align_t), "records must not be over-aligned");
 	
-	ReverseStream(Stream stream) 
-		: stream(stream), current(0) {}
+	std::shared_ptr<MappedFile const> file;
 	
-	decltype(auto) front() {
-		return reversed[current - 1];
-	}
+	MappedStream(std::shared_ptr<MappedFile const> file)
+		: IteratorStream<T const*, T const*>(records(*file), records(*file) + file->size() / sizeof(T), false), 
+		file(std::move(file)) {}
 	
-	bool next() {
-		if(!current++) {
-			while(stream.next())
-				reversed.push_back(stream.front());
-			std::reverse(reversed.begin(), reversed.end());
-		}
-		return current - 1 < reversed.size();
-	}
+	Buildable;
 	
-	bool endless() const {
-		return stream.endless();
+private:
+	static T const* records(MappedFile const& file) {
+		return reinterpret_cast<T const*>(file.data());
 	}
-	
-	Buildable;
 };
 
-template<typename Stream>
-struct DistinctStream {
-	using value_type = value_t<Stream>;
+// the lines of an input stream read into a reused buffer, a view is valid until the next call to next()
+struct LineStream {
+	using value_type = std::string_view;
 	
-	Stream stream;
-	using Set = std::set<value_type>;
-	Set set;
-	typename Set::const_iterator current;
+	std::istream* in;
+	std::string line;
+	char delimiter;
 	
-	DistinctStream(Stream stream) 
-		: stream(stream), set{}, current() {}
+	LineStream(std::istream& in, char delimiter) : in(&in), delimiter(delimiter) {}
 	
 	decltype(auto) front() {
-		return *current;
+		return std::string_view(line);
 	}
 	
 	bool next() {
-		while(stream.next())
-			if(auto [next, success] = set.insert(stream.front()); success)
-				return current = next, true;
-		return false;
+		return bool(std::getline(*in, line, delimiter));
 	}
 	
 	bool endless() const {
-		return stream.endless();
+		return false;
 	}
 	
 	Buildable;
 };
 
-template<typename Stream, typename Peeker>
-struct PeekStream {
+template<typename Stream, typename Pred>
+struct FilterStream {
 	using value_type = value_t<Stream>;
+	static constexpr bool stable_front = has_stable_front_v<Stream>;
 	
 	Stream stream;
-	Peeker peeker;
+	Pred pred;
 	
-	PeekStream(Stream stream, Peeker peeker) 
-		: stream(stream), peeker(peeker) {}
+	constexpr FilterStream(Stream stream, Pred pred)
+		: stream(std::move(stream)), pred(std::move(pred)) {}
 	
-	decltype(auto) front() {
+	constexpr decltype(auto) front() {
 		return stream.front();
 	}
 	
-	bool next() {
-		return stream.next() ? std::invoke(peeker, stream.front()), true : false;
+	constexpr bool next() {
+		while(stream.next())
+			if(std::invoke(pred, stream.front()))
+				return true;
+		return false;
 	}
 	
-	bool endless() const {
+	template<typename Sink>
+	constexpr bool for_each_until(Sink&& sink) {
+		return push_until(stream, [&](auto&& value) { 
+			return !std::invoke(pred, value) || std::invoke(sink, std::forward<decltype(value)>(value)); 
+		});
+	}
+	
+	constexpr bool endless() const {
 		return stream.endless();
 	}
 	
 	Buildable;
 };
 
-template<typename Stream>
-struct MakeEndlessStream {
-	using value_type = value_t<Stream>;
+template<typename Stream, typename Pred>
+struct MapStream {
+	using result_type = std::invoke_result_t<Pred&, reference_t<Stream>>;
+	static constexpr bool filtering = is_optional_v<result_type>;
+	// lvalue references returned by pred are kept as pointers instead of copies,
+	// only if front() of the upstream is an lvalue too, a reference into a temporary would dangle
+	static constexpr bool referencing = !filtering && std::is_lvalue_reference_v<result_type>
+		&& std::is_lvalue_reference_v<reference_t<Stream>>;
+	static constexpr bool stable_front = referencing && has_stable_front_v<Stream>;
+	using value_type = std::remove_cv_t<remove_optional_t<std::remove_cv_t<std::remove_reference_t<result_type>>>>;
+	// trivially copyable results are assigned to a plain cache instead of an optional
+	static constexpr bool direct = !referencing && is_blockable_v<value_type> && std::is_assignable_v<value_type&, value_type>;
 	
 	Stream stream;
+	Pred pred;
+	std::conditional_t<referencing, std::remove_reference_t<result_type>*, 
+		std::conditional_t<direct, value_type, std::optional<value_type>>> cache_value{};
+
+	constexpr MapStream(Stream stream, Pred pred)
+		: stream(std::move(stream)), pred(std::move(pred)) {}
+
+	constexpr decltype(auto) front() {
+		if constexpr(direct)
+			return (cache_value);
+		else
+			return *cache_value;
+	}
 	
-	MakeEndlessStream(Stream stream) 
-		: stream(stream) {}
+	template<bool R = referencing, typename = std::enable_if_t<!R>>
+	constexpr value_type take_front() {
+		if constexpr(direct)
+			return cache_value;
+		else
+			return *std::move(cache_value);
+	}
+
+	constexpr bool next() {
+		if constexpr(filtering) {
+			while(stream.next())
+				if(auto result = std::invoke(pred, stream.front()))
+					return cache(*std::move(result)), true;
+			return false;
+		} else if constexpr(referencing) {
+			return stream.next() && (cache_value = std::addressof(std::invoke(pred, stream.front())));
+		} else {
+			return stream.next() && (cache(std::invoke(pred, stream.front())), true);
+		}
+	}
 	
-	decltype(auto) front() {
-		return stream.front();
+	template<typename T>
+	constexpr void cache(T&& value) {
+		if constexpr(direct)
+			cache_value = std::forward<T>(value);
+		else
+			cache_value.emplace(std::forward<T>(value));
 	}
 	
-	bool next() {
-		return stream.next();
+	template<typename Sink>
+	constexpr bool for_each_until(Sink&& sink) {
+		return push_until(stream, [&](auto&& value) {
+			if constexpr(is_optional_v<std::invoke_result_t<Pred, decltype(value)>>) {
+				auto result = std::invoke(pred, std::forward<decltype(value)>(value));
+				return !result || std::invoke(sink, *std::move(result));
+			} else {
+				return std::invoke(sink, std::invoke(pred, std::forward<decltype(value)>(value)));
+			}
+		});
 	}
 	
-	bool endless() const {
-		return true;
+	template<typename Sink, typename S = Stream, typename = std::enable_if_t<has_for_each_block_v<S> && !filtering 
+		&& !referencing && is_blockable_v<value_type> && std::is_invocable_v<Pred&, value_t<S> const&>>>
+	constexpr bool for_each_block(Sink&& sink) {
+		value_type block[block_size];
+		return stream.for_each_block([&](value_t<Stream> const* data, size_t n) {
+			for(size_t offset = 0; offset < n; offset += block_size) {
+				size_t m = std::min(n - offset, block_size);
+				if(m == block_size)
+					for(size_t i = 0; i != block_size; ++i)
+						block[i] = std::invoke(pred, data[offset + i]);
+				else
+					for(size_t i = 0; i != m; ++i)
+						block[i] = std::invoke(pred, data[offset + i]);
+				if(!std::invoke(sink, static_cast<value_type const*>(block), m))
+					return false;
+			}
+			return true;
+		});
+	}
+	
+	template<typename S = Stream, typename = std::enable_if_t<!filtering && is_sized_v<S>>>
+	constexpr size_t size() const {
+		return stream.size();
+	}
+	
+	template<typename S = Stream, typename = std::enable_if_t<!filtering && is_random_access_v<S>>>
+	constexpr void advance(size_t n) {
+		stream.advance(n);
+	}
+	
+	template<bool F = filtering, typename = std::enable_if_t<!F>>
+	constexpr void demand(size_t n) {
+		hint_demand(stream, n);
+	}
+	
+	constexpr bool endless() const {
+		return stream.endless();
 	}
 	
 	Buildable;
 };
 
 template<typename Stream>
-struct TailRepeatStream {
-	using value_type = remove_optional_t<value_t<Stream>>;
+struct TakeStream {
+	using value_type = value_t<Stream>;
+	static constexpr bool stable_front = has_stable_front_v<Stream>;
 	
 	Stream stream;
-	bool remaining;
-	std::optional<value_type> cache;
+	size_t count;
 	
-	TailRepeatStream(Stream stream) 
-		: stream(stream), cache(), remaining(true) {}
+	constexpr TakeStream(Stream stream, size_t count)
+		: stream(std::move(stream)), count(count + 1){}
+		
+	constexpr decltype(auto) front() {
+		return stream.front();
+	}
 	
-	decltype(auto) front() {
-		return remaining ? (cache = stream.front()).value() : cache.value();
+	constexpr bool next() {
+		return count && --count != 0 && stream.next();
 	}
 	
-	bool next() {
-		if(!stream.next()) 
-			remaining = false;
-		return true;
+	template<typename Sink>
+	constexpr bool for_each_until(Sink&& sink) {
+		if(count <= 1)
+			return count = 0, true;
+		--count;
+		bool accepted = true;
+		push_until(stream, [&](auto&& value) {
+			return (accepted = std::invoke(sink, std::forward<decltype(value)>(value))) && --count != 0;
+		});
+		return accepted;
 	}
 	
-	bool endless() const {
-		return true;
+	template<typename Sink, typename S = Stream, typename = std::enable_if_t<has_for_each_block_v<S>>>
+	constexpr bool for_each_block(Sink&& sink) {
+		if(count <= 1)
+			return count = 0, true;
+		--count;
+		bool accepted = true;
+		stream.for_each_block([&](value_type const* data, size_t n) {
+			n = std::min(n, count);
+			count -= n;
+			return (accepted = std::invoke(sink, data, n)) && count != 0;
+		});
+		count = 0;
+		return accepted;
+	}
+	
+	template<typename S = Stream, typename = std::enable_if_t<is_sized_v<S> || is_random_access_v<S>>>
+	constexpr size_t size() const {
+		if constexpr(is_sized_v<S>)
+			return std::min(remaining(), stream.size());
+		else
+			return remaining();
+	}
+	
+	template<typename S = Stream, typename = std::enable_if_t<is_random_access_v<S>>>
+	constexpr void advance(size_t n) {
+		n = std::min(n, remaining());
+		count -= n;
+		stream.advance(n);
+	}
+	
+	constexpr void demand(size_t n) {
+		hint_demand(stream, std::min(n, remaining()));
+	}
+	
+	constexpr bool endless() const {
+		return false;
+	}
+	
+	constexpr size_t remaining() const {
+		return count ? count - 1 : 0;
 	}
 	
 	Buildable;
 };
 
 template<typename Stream>
-struct LoopStream {
+struct SkipStream {
 	using value_type = value_t<Stream>;
+	static constexpr bool stable_front = has_stable_front_v<Stream>;
 	
-	Stream stream, cache;
-	
-	LoopStream(Stream stream) 
-		: stream(stream), cache(stream) {}
+	Stream stream;
+	size_t count;
 	
-	decltype(auto) front() {
+	constexpr SkipStream(Stream stream, size_t count)
+		: stream(std::move(stream)), count(count + 1) {}
+		
+	constexpr decltype(auto) front() {
 		return stream.front();
 	}
 	
-	bool next() {
-		while(!stream.next())
-			stream = cache;
-		return true;
+	constexpr bool next() {
+		if constexpr(is_random_access_v<Stream>) {
+			if(count)
+				stream.advance(count - 1), count = 0;
+		} else {
+			while(count && --count != 0 && stream.next());
+		}
+		return stream.next();
 	}
 	
-	bool endless() const {
-		return true;
+	template<typename Sink>
+	constexpr bool for_each_until(Sink&& sink) {
+		if constexpr(is_random_access_v<Stream>) {
+			if(count)
+				stream.advance(count - 1), count = 0;
+		}
+		if(count > 1 && push_until(stream, [this](auto&&) { return --count > 1; }))
+			return count = 0, true;
+		count = 0;
+		return push_until(stream, sink);
+	}
+	
+	template<typename S = Stream, typename = std::enable_if_t<is_sized_v<S>>>
+	constexpr size_t size() const {
+		return stream.size() - std::min(count ? count - 1 : 0, stream.size());
+	}
+	
+	template<typename S = Stream, typename = std::enable_if_t<is_random_access_v<S>>>
+	constexpr void advance(size_t n) {
+		stream.advance((count ? count - 1 : 0) + n);
+		count = 0;
+	}
+	
+	constexpr void demand(size_t n) {
+		hint_demand(stream, scale_demand(n, 1, count ? count - 1 : 0));
+	}
+	
+	constexpr bool endless() const {
+		return stream.endless();
 	}
 	
 	Buildable;
 };
 
-template<typename Stream>
-struct EndlessFlatStream {
-	using value_type = value_t<value_t<Stream>>;
+// filter(p) >> filter(q) is fused into filter(p && q)
+template<typename First, typename Second>
+struct Conjunction {
+	First first;
+	Second second;
+	
+	template<typename T, typename = std::enable_if_t<std::is_invocable_v<First&, T&> && std::is_invocable_v<Second&, T&>>>
+	constexpr bool operator()(T&& value) {
+		return std::invoke(first, value) && std::invoke(second, value);
+	}
+};
+
+// map(f) >> map(g) is fused into map(g(f(x)))
+template<typename First, typename Second>
+struct Composition {
+	First first;
+	Second second;
+	
+	template<typename T>
+	constexpr auto operator()(T&& value) -> std::invoke_result_t<Second&, std::invoke_result_t<First&, T>> {
+		return std::invoke(second, std::invoke(first, std::forward<T>(value)));
+	}
+};
+
+// map(f) >> filter(p) is fused into a filtering map
+template<typename Map, typename Filter>
+struct MapFilter {
+	Map map;
+	Filter filter;
+	
+	template<typename T>
+	constexpr auto operator()(T&& value) -> std::optional<std::decay_t<std::invoke_result_t<Map&, T>>> {
+		std::optional<std::decay_t<std::invoke_result_t<Map&, T>>> result(std::in_place, std::invoke(map, std::forward<T>(value)));
+		if(!std::invoke(filter, *result))
+			result.reset();
+		return result;
+	}
+};
+
+// filter(p) >> map(f) is fused into a filtering map
+template<typename Filter, typename Map>
+struct FilterMap {
+	Filter filter;
+	Map map;
+	
+	template<typename T>
+	constexpr auto operator()(T&& value) -> std::optional<std::decay_t<std::invoke_result_t<Map&, T>>> {
+		if(!std::invoke(filter, value))
+			return std::nullopt;
+		return std::optional<std::decay_t<std::invoke_result_t<Map&, T>>>(std::in_place, std::invoke(map, std::forward<T>(value)));
+	}
+};
+
+// the element produced by a fused map is moved once more through an optional, cheap only for trivially copyable ones
+template<typename T>
+constexpr bool is_fusible_value_v = !std::is_reference_v<T> && !is_optional_v<T> && std::is_trivially_copyable_v<T>;
+
+template<>
+struct StageFusion<FilterStream> {
+	template<typename Upstream, typename Pred>
+	static constexpr auto fuse(Upstream&& upstream, Pred&& pred) {
+		using U = std::decay_t<Upstream>;
+		using P = std::decay_t<Pred>;
+		if constexpr(is_stage_of_v<FilterStream, U>) {
+			return FilterStream(std::forward<Upstream>(upstream).stream, 
+				Conjunction<decltype(upstream.pred), P>{std::forward<Upstream>(upstream).pred, std::forward<Pred>(pred)});
+		} else if constexpr(is_map_filter_fusible<U, P>()) {
+			return MapStream(std::forward<Upstream>(upstream).stream, 
+				MapFilter<decltype(upstream.pred), P>{std::forward<Upstream>(upstream).pred, std::forward<Pred>(pred)});
+		} else {
+			return FilterStream<U, P>(std::forward<Upstream>(upstream), std::forward<Pred>(pred));
+		}
+	}
+	
+	template<typename U, typename P>
+	static constexpr bool is_map_filter_fusible() {
+		if constexpr(is_stage_of_v<MapStream, U>)
+			return !U::filtering && is_fusible_value_v<typename U::result_type> 
+				&& std::is_invocable_v<P&, typename U::value_type&>;
+		else
+			return false;
+	}
+};
+
+template<>
+struct StageFusion<MapStream> {
+	template<typename Upstream, typename Pred>
+	static constexpr auto fuse(Upstream&& upstream, Pred&& pred) {
+		using U = std::decay_t<Upstream>;
+		using P = std::decay_t<Pred>;
+		if constexpr(is_map_map_fusible<U, P>()) {
+			return MapStream(std::forward<Upstream>(upstream).stream, 
+				Composition<decltype(upstream.pred), P>{std::forward<Upstream>(upstream).pred, std::forward<Pred>(pred)});
+		} else if constexpr(is_filter_map_fusible<U, P>()) {
+			return MapStream(std::forward<Upstream>(upstream).stream, 
+				FilterMap<decltype(upstream.pred), P>{std::forward<Upstream>(upstream).pred, std::forward<Pred>(pred)});
+		} else {
+			return MapStream<U, P>(std::forward<Upstream>(upstream), std::forward<Pred>(pred));
+		}
+	}
+	
+	// the intermediate result is passed as it is, references into a temporary one would dangle
+	template<typename U, typename P>
+	static constexpr bool is_map_map_fusible() {
+		if constexpr(is_stage_of_v<MapStream, U>) {
+			using First = typename U::result_type;
+			if constexpr(!U::filtering && std::is_invocable_v<P&, First>)
+				return std::is_lvalue_reference_v<First> || !std::is_reference_v<std::invoke_result_t<P&, First>>;
+			else
+				return false;
+		} else {
+			return false;
+		}
+	}
+	
+	template<typename U, typename P>
+	static constexpr bool is_filter_map_fusible() {
+		if constexpr(is_stage_of_v<FilterStream, U>) {
+			if constexpr(std::is_invocable_v<P&, reference_t<U>>)
+				return is_fusible_value_v<std::invoke_result_t<P&, reference_t<U>>>;
+			else
+				return false;
+		} else {
+			return false;
+		}
+	}
+};
+
+// take(a) >> take(b) is fused into take(min(a, b)) and skip(a) >> skip(b) into skip(a + b)
+template<>
+struct StageFusion<TakeStream> {
+	template<typename Upstream>
+	static constexpr auto fuse(Upstream&& upstream, size_t count) {
+		using U = std::decay_t<Upstream>;
+		if constexpr(is_stage_of_v<TakeStream, U>)
+			return TakeStream(std::forward<Upstream>(upstream).stream, std::min(upstream.remaining(), count));
+		else
+			return TakeStream<U>(std::forward<Upstream>(upstream), count);
+	}
+};
+
+template<>
+struct StageFusion<SkipStream> {
+	template<typename Upstream>
+	static constexpr auto fuse(Upstream&& upstream, size_t count) {
+		using U = std::decay_t<Upstream>;
+		if constexpr(is_stage_of_v<SkipStream, U>) {
+			size_t pending = upstream.count ? upstream.count - 1 : 0;
+			return SkipStream(std::forward<Upstream>(upstream).stream, count > size_t(-2) - pending ? size_t(-2) : pending + count);
+		} else {
+			return SkipStream<U>(std::forward<Upstream>(upstream), count);
+		}
+	}
+};
+
+template<typename Stream, typename Pred>
+struct TakeWhileStream {
+	using value_type = value_t<Stream>;
+	static constexpr bool stable_front = has_stable_front_v<Stream>;
 	
 	Stream stream;
+	Pred pred;
 	bool remaining;
 	
-	EndlessFlatStream(Stream stream) 
-		: stream(stream), remaining(false) {}
+	constexpr TakeWhileStream(Stream stream, Pred pred)
+		: stream(std::move(stream)), pred(std::move(pred)), remaining(true) {}
+		
+	constexpr decltype(auto) front() {
+		return stream.front();
+	}
 	
-	decltype(auto) front() {
-		return stream.front().front();
+	constexpr bool next() {
+		return remaining && (remaining = (stream.next() && std::invoke(pred, stream.front())));
 	}
 	
-	bool next() {
-		return (remaining && stream.front().next()) || ((remaining = (remaining = false, stream.next())) && stream.front().next());
+	template<typename Sink>
+	constexpr bool for_each_until(Sink&& sink) {
+		bool accepted = true;
+		if(remaining && push_until(stream, [&](auto&& value) {
+			return (remaining = std::invoke(pred, value)) 
+				&& (accepted = std::invoke(sink, std::forward<decltype(value)>(value)));
+		}))
+			remaining = false;
+		return accepted;
 	}
 	
-	bool endless() const {
-		return true; // depending on what the stream contains 
+	constexpr void demand(size_t n) {
+		hint_demand(stream, n);
+	}
+	
+	constexpr bool endless() const {
+		return stream.endless(); // depending on stream as well as pred
 	}
 	
 	Buildable;
 };
 
-template<typename Stream>
-struct FlatStream {
-	using value_type = value_t<value_t<Stream>>;
+template<typename Stream, typename Pred>
+struct SkipWhileStream {
+	using value_type = value_t<Stream>;
+	static constexpr bool stable_front = has_stable_front_v<Stream>;
 	
 	Stream stream;
-	std::vector<value_t<Stream>> streams;
-	size_t current; 
+	Pred pred;
+	bool remaining;
 	
-	FlatStream(Stream stream) 
-		: stream(stream), streams(), current(0) {
-		while(stream.next())
-			streams.push_back(stream.front());
+	constexpr SkipWhileStream(Stream stream, Pred pred)
+		: stream(std::move(stream)), pred(std::move(pred)), remaining(true){}
+		
+	constexpr decltype(auto) front() {
+		return stream.front();
 	}
 	
-	decltype(auto) front() {
-		return streams[current].front();
+	constexpr bool next() {
+		while(remaining) {
+			if(!stream.next()) 
+				return remaining = false;
+			if(!std::invoke(pred, stream.front()))
+				return !(remaining = false);
+		}
+		return stream.next();
 	}
 	
-	bool next() {
-		return current != streams.size() && (streams[current].next() || (++current && next()));
+	template<typename Sink>
+	constexpr bool for_each_until(Sink&& sink) {
+		if(remaining) {
+			bool accepted = true;
+			if(push_until(stream, [&](auto&& value) {
+				return std::invoke(pred, value) 
+					|| (remaining = false, accepted = std::invoke(sink, std::forward<decltype(value)>(value)), false);
+			}))
+				return remaining = false, true;
+			if(!accepted)
+				return false;
+		}
+		return push_until(stream, sink);
 	}
 	
-	bool endless() const {
-		return std::all_of(streams.begin(), streams.end(), [](auto const& stream) { return stream.endless(); });	
+	constexpr bool endless() const {
+		return stream.endless();
 	}
 	
 	Buildable;
 };
 
-template<typename StreamA, typename StreamB>
-struct JoinStreamAB {
-	static_assert(std::is_convertible_v<value_t<StreamB>, value_t<StreamA>>);
-	using value_type = value_t<StreamA>; 
-	
-	StreamA streamA;
-	StreamB streamB;
-	bool B;
+// groups the elements into chunks of count elements, the last one may be shorter
+// front() refers to a buffer reused by the next chunk, move it out to keep it
+template<typename Stream>
+struct ChunkStream {
+	using value_type = std::vector<std::remove_cv_t<std::remove_reference_t<value_t<Stream>>>>;
 	
-	JoinStreamAB(StreamA streamA, StreamB streamB) 
-		: streamA(streamA), streamB(streamB), B(false) {}
+	Stream stream;
+	size_t count;
+	value_type chunk;
 	
+	ChunkStream(Stream stream, size_t count)
+		: stream(std::move(stream)), count(std::max(count, size_t(1))) {}
+		
 	decltype(auto) front() {
-		return B ? streamB.front() : streamA.front();
+		return (chunk);
 	}
 	
 	bool next() {
-		return streamA.next() || (B = true, streamB.next());
+		chunk.clear();
+		chunk.reserve(count);
+		push_until(stream, [this](auto&& value) {
+			return chunk.push_back(std::forward<decltype(value)>(value)), chunk.size() != count;
+		});
+		return !chunk.empty();
+	}
+	
+	template<typename S = Stream, typename = std::enable_if_t<is_sized_v<S>>>
+	size_t size() const {
+		return (stream.size() + count - 1) / count;
+	}
+	
+	void demand(size_t n) {
+		hint_demand(stream, scale_demand(n, count));
 	}
 	
 	bool endless() const {
-		return streamA.endless() || streamB.endless();
+		return stream.endless();
 	}
 	
 	Buildable;
 };
 
-template<typename ...Streams>
-struct JoinStreams {};
-
-template<typename StreamA, typename ...Streams>
-struct JoinStreams<StreamA, Streams...> : JoinStreamAB<StreamA, JoinStreams<Streams...>> {
-	using extended = JoinStreamAB<StreamA, JoinStreams<Streams...>>;
-	JoinStreams(StreamA streamA, Streams... streams)
-		: extended(streamA, JoinStreams<Streams...>(streams...)) {}
-	using extended::front;
-	using extended::next;
-	using extended::endless;
+// a window over a ring buffer, the oldest element first
+template<typename T>
+class RingView {
+	T const* ring;
+	size_t capacity, head;
+	
+public:
+	class Iterator {
+		T const* ring;
+		size_t capacity, index;
+		
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = T const*;
+		using reference = T const&;
+		
+		Iterator(T const* ring, size_t capacity, size_t index) : ring(ring), capacity(capacity), index(index) {}
+		
+		T const& operator*() const {
+			return ring[index < capacity ? index : index - capacity];
+		}
+		
+		T const* operator->() const {
+			return &**this;
+		}
+		
+		Iterator& operator++() {
+			return ++index, *this;
+		}
+		
+		Iterator operator++(int) {
+			Iterator temp = *this;
+			return ++index, temp;
+		}
+		
+		friend bool operator==(Iterator const& left, Iterator const& right) {
+			return left.index == right.index;
+		}
+		
+		friend bool operator!=(Iterator const& left, Iterator const& right) {
+			return left.index != right.index;
+		}
+	};
 	
-	Buildable;
-};
-
-template<typename StreamA, typename StreamB>
-struct JoinStreams<StreamA, StreamB> : JoinStreamAB<StreamA, StreamB> {
-	using extended = JoinStreamAB<StreamA, StreamB>;
-	using extended::extended;
-	using extended::front;
-	using extended::next;
-	using extended::endless;
+	RingView(T const* ring, size_t capacity, size_t head) : ring(ring), capacity(capacity), head(head) {}
 	
-	Buildable;
+	T const& operator[](size_t i) const {
+		return *Iterator(ring, capacity, head + i);
+	}
+	
+	T const& front() const {
+		return (*this)[0];
+	}
+	
+	T const& back() const {
+		return (*this)[capacity - 1];
+	}
+	
+	size_t size() const {
+		return capacity;
+	}
+	
+	Iterator begin() const {
+		return Iterator(ring, capacity, head);
+	}
+	
+	Iterator end() const {
+		return Iterator(ring, capacity, head + capacity);
+	}
 };
 
-template<typename StreamA>
-struct JoinStreams<StreamA> {
-	using extended = StreamA;
-	using extended::extended;
-	using extended::front;
-	using extended::next;
-	using extended::endless;
+// windows of the count consecutive elements starting at every step-th element, only full windows are yielded
+// front() views the ring buffer, which is overwritten by the next window
+template<typename Stream>
+struct SlidingStream {
+	using element_type = std::remove_cv_t<std::remove_reference_t<value_t<Stream>>>;
+	using value_type = RingView<element_type>;
+	
+	Stream stream;
+	size_t count, step;
+	std::vector<element_type> ring;
+	size_t head;
+	
+	SlidingStream(Stream stream, size_t count, size_t step)
+		: stream(std::move(stream)), count(std::max(count, size_t(1))), step(std::max(step, size_t(1))), head(0) {}
+	
+	value_type front() const {
+		return value_type(ring.data(), count, head);
+	}
+	
+	bool next() {
+		if(ring.size() < count) {
+			ring.reserve(count);
+			push_until(stream, [this](auto&& value) {
+				return ring.push_back(std::forward<decltype(value)>(value)), ring.size() != count;
+			});
+			return ring.size() == count;
+		}
+		size_t pulled = 0;
+		push_until(stream, [this, &pulled](auto&& value) {
+			ring[head] = std::forward<decltype(value)>(value);
+			if(++head == count)
+				head = 0;
+			return ++pulled != step;
+		});
+		return pulled == step;
+	}
+	
+	template<typename S = Stream, typename = std::enable_if_t<is_sized_v<S>>>
+	size_t size() const {
+		if(ring.size() == count)
+			return stream.size() / step;
+		return stream.size() < count ? 0 : (stream.size() - count) / step + 1;
+	}
+	
+	void demand(size_t n) {
+		hint_demand(stream, n ? scale_demand(n - 1, step, count) : 0);
+	}
+	
+	bool endless() const {
+		return stream.endless();
+	}
 	
 	Buildable;
 };
 
-template<typename Pred, typename ...Streams>
-struct CombineStreams {
-	using value_type = remove_optional_t<std::invoke_result_t<Pred, value_t<Streams>...>>;
+// op over the last count elements of each full window, updating a running result with op and inverse
+template<typename Stream, typename Op, typename Inverse>
+struct InvertibleSlidingStream {
+	using value_type = std::remove_cv_t<std::remove_reference_t<value_t<Stream>>>;
 	
-	Pred pred;
-	std::optional<value_type> cache;
-	std::tuple<Streams...> streams;
+	Stream stream;
+	size_t count;
+	Op op;
+	Inverse inverse;
+	std::vector<value_type> ring;
+	size_t head;
+	std::optional<value_type> result;
 	
-	CombineStreams(Pred pred, Streams... streams) 
-		: pred(pred), streams(streams...) {}
+	InvertibleSlidingStream(Stream stream, size_t count, Op op, Inverse inverse)
+		: stream(std::move(stream)), count(std::max(count, size_t(1))), op(std::move(op)), inverse(std::move(inverse)), head(0) {}
 	
-	decltype(auto) front() {
-		return *cache;
+	value_type const& front() const {
+		return *result;
 	}
 	
 	bool next() {
-		return std::apply([](auto... streams){ return (streams.next() && ...); }, streams) 
-		&& ((cache = std::apply([this](auto... streams){ return std::invoke(pred, streams.front()...); }, streams)), true);
+		if(ring.size() < count) {
+			ring.reserve(count);
+			push_until(stream, [this](auto&& value) {
+				ring.push_back(std::forward<decltype(value)>(value));
+				result = result ? std::invoke(op, std::move(*result), ring.back()) : ring.back();
+				return ring.size() != count;
+			});
+			return ring.size() == count;
+		}
+		if(!stream.next())
+			return false;
+		value_type value = stream.front();
+		result = std::invoke(inverse, std::invoke(op, std::move(*result), value), ring[head]);
+		ring[head] = std::move(value);
+		if(++head == count)
+			head = 0;
+		return true;
+	}
+	
+	template<typename S = Stream, typename = std::enable_if_t<is_sized_v<S>>>
+	size_t size() const {
+		return ring.size() < count ? (stream.size() < count ? 0 : stream.size() - count + 1) : stream.size();
 	}
 	
 	bool endless() const {
-		return std::apply([](auto... streams){ return (streams.endless() && ...); }, streams);
+		return stream.endless();
 	}
 	
 	Buildable;
 };
 
-struct IterableBuilder {
-	template<typename Stream>
-	struct Iterable {
-		struct Iterator {
-			using iterator_category = std::forward_iterator_tag;
-			using value_type = std::remove_cv_t<std::remove_reference_t<value_t<Stream>>>;
-			using difference_type = size_t;
-			using pointer = value_type*;
-			using reference = value_type&;
-			
-			Stream* stream;
-			bool next;
-			
-			Iterator() : stream(nullptr), next(false) {}
-			
-			explicit Iterator(Stream* stream) 
-				: stream(stream), next(stream->next()) {}
-			
-			Iterator& operator++() {
-				next = stream->next();
-				return *this;
-			}
-			
-			auto operator++(int) {
-				struct TempIterator {
-					value_t<Stream> cache_value;
+// op over the last count elements of each full window, op must be associative but needs no inverse
+// the window is a queue of two stacks: the older one keeps the suffix results, the newer one keeps the elements and their result
+template<typename Stream, typename Op>
+struct SlidingReduceStream {
+	using value_type = std::remove_cv_t<std::remove_reference_t<value_t<Stream>>>;
+	
+	Stream stream;
+	size_t count;
+	Op op;
+	std::vector<value_type> older, newer;
+	std::optional<value_type> newer_result, result;
+	
+	SlidingReduceStream(Stream stream, size_t count, Op op)
+		: stream(std::move(stream)), count(std::max(count, size_t(1))), op(std::move(op)) {}
+	
+	value_type const& front() const {
+		return *result;
+	}
+	
+	bool next() {
+		bool filled = older.size() + newer.size() == count;
+		if(!filled) {
+			older.reserve(count);
+			newer.reserve(count);
+			push_until(stream, [this](auto&& value) {
+				push(std::forward<decltype(value)>(value));
+				return newer.size() != count;
+			});
+			if(newer.size() != count)
+				return false;
+		} else {
+			if(!stream.next())
+				return false;
+			if(older.empty())
+				flip();
+			older.pop_back();
+			push(stream.front());
+		}
+		result = older.empty() ? *newer_result : std::invoke(op, older.back(), *newer_result);
+		return true;
+	}
+	
+	template<typename S = Stream, typename = std::enable_if_t<is_sized_v<S>>>
+	size_t size() const {
+		bool filled = older.size() + newer.size() == count;
+		return filled ? stream.size() : stream.size() < count ? 0 : stream.size() - count + 1;
+	}
+	
+	bool endless() const {
+		return stream.endless();
+	}
+	
+	Buildable;
+	
+private:
+	template<typename T>
+	void push(T&& value) {
+		newer_result = newer.empty() ? value_type(value) : std::invoke(op, std::move(*newer_result), value);
+		newer.push_back(std::forward<T>(value));
+	}
+	
+	// moves the elements to the older stack, turning them into the results of them and the newer ones.
+	void flip() {
+		for(size_t i = newer.size(); i--;)
+			older.push_back(older.empty() ? std::move(newer[i]) : std::invoke(op, std::move(newer[i]), older.back()));
+		newer.clear();
+		newer_result.reset();
+	}
+};
+
+template<typename Stream, typename Compare>
+struct SortStream {
+	using value_type = value_t<Stream>;
+	static constexpr bool stable_front = true;
+	
+	Stream stream;
+	Compare compare;
+	std::pmr::vector<buffered_t<Stream>> sorted;
+	size_t current;
+	bool stable;
+	size_t limit; // only the first limit elements in order are kept 
+	
+	SortStream(Stream stream, Compare compare, bool stable = true) 
+		: stream(std::move(stream)), compare(std::move(compare)), sorted(memory_resource_of(this->stream)), 
+		current(0), stable(stable), limit(-1) {}
+	
+	decltype(auto) front() {
+		return from_buffered<Stream>(sorted[current - 1]);
+	}
+	
+	bool next() {
+		if(!current++) {
+			if constexpr(is_sized_v<Stream>)
+				if(limit >= stream.size())
+					limit = -1;
+			if(limit == size_t(-1))
+				sort_all();
+			else
+				sort_first();
+		}
+		return current - 1 < sorted.size();
+	}
+	
+	void demand(size_t n) {
+		limit = std::min(limit, n);
+	}
+	
+	bool less(buffered_t<Stream> const& a, buffered_t<Stream> const& b) {
+		return std::invoke(compare, from_buffered<Stream>(a), from_buffered<Stream>(b));
+	}
+	
+	void sort_all() {
+		if constexpr(is_sized_v<Stream>)
+			sorted.reserve(stream.size());
+		push_until(stream, [this](auto&& value) { 
+			return sorted.push_back(to_buffered<Stream>(std::forward<decltype(value)>(value))), true; 
+		});
+		auto less = [this](auto const& a, auto const& b) { return this->less(a, b); };
+		if(stable)
+			stable_sort_in(sorted, less);
+		else
+			std::sort(sorted.begin(), sorted.end(), less);
+	}
+	
+	// keeps the first limit elements in a max-heap, ties are broken by the order of arrival
+	void sort_first() {
+		if(!limit)
+			return;
+		std::pmr::vector<std::pair<buffered_t<Stream>, size_t>> heap(sorted.get_allocator());
+		heap.reserve(std::min(limit, size_t(1) << 16));
+		auto before = [this](auto const& a, auto const& b) { 
+			return less(a.first, b.first) || (!less(b.first, a.first) && a.second < b.second); 
+		};
+		size_t arrival = 0;
+		push_until(stream, [&](auto&& value) {
+			if(heap.size() < limit) {
+				heap.emplace_back(to_buffered<Stream>(std::forward<decltype(value)>(value)), arrival++);
+				std::push_heap(heap.begin(), heap.end(), before);
+			} else if(std::invoke(compare, value, from_buffered<Stream>(heap.front().first))) {
+				std::pop_heap(heap.begin(), heap.end(), before);
+				heap.back() = {to_buffered<Stream>(std::forward<decltype(value)>(value)), arrival++};
+				std::push_heap(heap.begin(), heap.end(), before);
+			}
+			return true;
+		});
+		std::sort_heap(heap.begin(), heap.end(), before);
+		sorted.reserve(heap.size());
+		for(auto& [element, _] : heap)
+			sorted.push_back(std::move(element));
+	}
+	
+	size_t buffered() const {
+		return sorted.size();
+	}
+	
+	bool endless() const {
+		return stream.endless();
+	}
+	
+	Buildable;
+};
+
+template<typename Stream>
+struct ReverseStream {
+	using value_type = value_t<Stream>;
+	static constexpr bool stable_front = true;
+	
+	Stream stream;
+	std::pmr::vector<buffered_t<Stream>> reversed;
+	size_t current;
+	size_t limit; // only the last limit elements are kept
+	
+	ReverseStream(Stream stream) 
+		: stream(std::move(stream)), reversed(memory_resource_of(this->stream)), current(0), limit(-1) {}
+	
+	// the buffer is read from the back instead of being reversed
+	decltype(auto) front() {
+		return from_buffered<Stream>(reversed[reversed.size() - current]);
+	}
+	
+	bool next() {
+		if(!current++) {
+			// drops the older half once the buffer holds twice the demand
+			size_t capacity = limit == size_t(-1) ? limit : std::max(limit, size_t(1)) * 2;
+			if constexpr(is_sized_v<Stream>)
+				reversed.reserve(std::min(capacity, stream.size()));
+			push_until(stream, [this, capacity](auto&& value) { 
+				if(reversed.size() == capacity)
+					reversed.erase(reversed.begin(), reversed.begin() + capacity / 2);
+				return reversed.push_back(to_buffered<Stream>(std::forward<decltype(value)>(value))), true; 
+			});
+		}
+		return current <= reversed.size();
+	}
+	
+	void demand(size_t n) {
+		limit = std::min(limit, n);
+	}
+	
+	size_t buffered() const {
+		return reversed.size();
+	}
+	
+	bool endless() const {
+		return stream.endless();
+	}
+	
+	Buildable;
+};
+
+// reverses a stream without buffering it, only for sources walking backwards and the element-wise adaptors over them
+template<typename Stream, typename = void>
+struct Reverser {
+	static constexpr bool reversible = false;
+};
+
+template<typename Iterator>
+struct Reverser<IteratorStream<Iterator, Iterator>, std::enable_if_t<std::is_base_of_v<std::bidirectional_iterator_tag, 
+	typename std::iterator_traits<Iterator>::iterator_category>>> {
+	static constexpr bool reversible = true;
+	
+	static auto reverse(IteratorStream<Iterator, Iterator> stream) {
+		return IteratorStream(std::make_reverse_iterator(stream.last), std::make_reverse_iterator(stream.upcoming), false);
+	}
+};
+
+// the last count elements of iota(first, step) are iota(last, -step)
+template<typename IntType>
+struct Reverser<TakeStream<IntegerStream<IntType>>> {
+	static constexpr bool reversible = true;
+	
+	static auto reverse(TakeStream<IntegerStream<IntType>> stream) {
+		size_t count = stream.remaining();
+		IntType last = stream.stream.current + stream.stream.step * IntType(count);
+		return TakeStream(IntegerStream<IntType>(last, IntType(0) - stream.stream.step), count);
+	}
+};
+
+template<typename Stream>
+constexpr bool is_reversible_v = Reverser<Stream>::reversible;
+
+template<typename Stream>
+struct Reverser<TakeStream<Stream>, std::enable_if_t<is_sized_v<Stream> && is_reversible_v<Stream>>> {
+	static constexpr bool reversible = is_random_access_v<decltype(Reverser<Stream>::reverse(std::declval<Stream>()))>;
+	
+	static auto reverse(TakeStream<Stream> stream) {
+		size_t count = stream.size(), extra = stream.stream.size() - count;
+		auto reversed = Reverser<Stream>::reverse(std::move(stream.stream));
+		reversed.advance(extra);
+		return reversed;
+	}
+};
+
+template<typename Stream>
+struct Reverser<SkipStream<Stream>, std::enable_if_t<is_random_access_v<Stream> && is_reversible_v<Stream>>> {
+	static constexpr bool reversible = true;
+	
+	static auto reverse(SkipStream<Stream> stream) {
+		stream.advance(0);
+		return Reverser<Stream>::reverse(std::move(stream.stream));
+	}
+};
+
+template<typename Stream, typename Pred>
+struct Reverser<FilterStream<Stream, Pred>, std::enable_if_t<is_reversible_v<Stream>>> {
+	static constexpr bool reversible = true;
+	
+	static auto reverse(FilterStream<Stream, Pred> stream) {
+		return FilterStream(Reverser<Stream>::reverse(std::move(stream.stream)), std::move(stream.pred));
+	}
+};
+
+template<typename Stream, typename Pred>
+struct Reverser<MapStream<Stream, Pred>, std::enable_if_t<is_reversible_v<Stream>>> {
+	static constexpr bool reversible = true;
+	
+	static auto reverse(MapStream<Stream, Pred> stream) {
+		return MapStream(Reverser<Stream>::reverse(std::move(stream.stream)), std::move(stream.pred));
+	}
+};
+
+#ifndef CPP_STREAM_NO_PROFILE
+template<typename Stream>
+struct Reverser<ProfileStream<Stream>, std::enable_if_t<is_reversible_v<Stream>>> {
+	static constexpr bool reversible = true;
+	
+	static auto reverse(ProfileStream<Stream> stream) {
+		auto reversed = Reverser<Stream>::reverse(std::move(stream.stream));
+		return ProfileStream<decltype(reversed)>(std::move(reversed), std::move(stream.node));
+	}
+};
+#endif
+
+// iterates the engaged slots of a flat hash table
+template<typename Slot>
+class FlatHashIterator {
+	Slot* slot;
+	Slot* last;
+	
+public:
+	using iterator_category = std::forward_iterator_tag;
+	using value_type = typename std::remove_const_t<Slot>::value_type;
+	using difference_type = std::ptrdiff_t;
+	using reference = decltype(**std::declval<Slot*>());
+	using pointer = std::remove_reference_t<reference>*;
+	
+	FlatHashIterator(Slot* slot, Slot* last) : slot(slot), last(last) {
+		while(this->slot != last && !*this->slot)
+			++this->slot;
+	}
+	
+	reference operator*() const {
+		return **slot;
+	}
+	
+	pointer operator->() const {
+		return std::addressof(**slot);
+	}
+	
+	FlatHashIterator& operator++() {
+		do ++slot; while(slot != last && !*slot);
+		return *this;
+	}
+	
+	FlatHashIterator operator++(int) {
+		FlatHashIterator old = *this;
+		return ++*this, old;
+	}
+	
+	bool operator==(FlatHashIterator const& other) const {
+		return slot == other.slot;
+	}
+	
+	bool operator!=(FlatHashIterator const& other) const {
+		return slot != other.slot;
+	}
+};
+
+struct KeyOfSelf {
+	template<typename T>
+	T const& operator()(T const& value) const {
+		return value;
+	}
+};
+
+struct KeyOfFirst {
+	template<typename T>
+	auto const& operator()(T const& value) const {
+		return value.first;
+	}
+};
+
+// open addressing hash table with linear probing over one flat array of slots, KeyOf picks the key of an element
+template<typename T, typename KeyOf, typename Hash, typename Equal>
+class FlatHashTable {
+protected:
+	std::pmr::vector<std::optional<T>> slots;
+	size_t count;
+	unsigned shift = 64; // the slot of a hash is in its top log2(slots.size()) bits 
+	Hash hash;
+	Equal equal;
+	
+	template<typename U>
+	size_t ideal(U const& key) const {
+		// fibonacci hashing spreads consecutive integers, the usual keys, over distinct slots
+		std::uint64_t h = static_cast<std::uint64_t>(std::invoke(hash, key)) * 0x9e3779b97f4a7c15ULL;
+		return static_cast<size_t>(h >> shift);
+	}
+	
+	template<typename U>
+	size_t probe(U const& key) const {
+		size_t i = ideal(key);
+		while(slots[i] && !std::invoke(equal, KeyOf{}(*slots[i]), key))
+			i = (i + 1) & (slots.size() - 1);
+		return i;
+	}
+	
+	void rehash(size_t capacity) {
+		std::pmr::vector<std::optional<T>> old(capacity, slots.get_allocator());
+		old.swap(slots);
+		for(shift = 64; capacity > 1; capacity >>= 1)
+			--shift;
+		for(auto& slot : old)
+			if(slot)
+				slots[probe(KeyOf{}(*slot))] = std::move(slot);
+	}
+	
+	// constructs the element from args unless key is present
+	template<typename U, typename... Args>
+	std::pair<T*, bool> emplace_key(U const& key, Args&&... args) {
+		if(count >= slots.size() / 4 * 3)
+			rehash(std::max(slots.size() * 2, size_t(16)));
+		auto& slot = slots[probe(key)];
+		if(slot)
+			return {&*slot, false};
+		slot.emplace(std::forward<Args>(args)...);
+		++count;
+		return {&*slot, true};
+	}
+	
+public:
+	explicit FlatHashTable(Hash hash = {}, Equal equal = {}, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+		: slots(resource), count(0), hash(std::move(hash)), equal(std::move(equal)) {}
+	
+	size_t size() const {
+		return count;
+	}
+	
+	bool empty() const {
+		return count == 0;
+	}
+	
+	// keeps the load factor under 3/4
+	void reserve(size_t n) {
+		size_t capacity = 16;
+		while(capacity / 4 * 3 < n)
+			capacity *= 2;
+		if(capacity > slots.size())
+			rehash(capacity);
+	}
+	
+	template<typename U>
+	bool contains(U const& key) const {
+		return count && slots[probe(key)];
+	}
+	
+	// backward shift deletion, no tombstones are left
+	template<typename U>
+	bool erase(U const& key) {
+		if(!count)
+			return false;
+		size_t i = probe(key), mask = slots.size() - 1;
+		if(!slots[i])
+			return false;
+		slots[i].reset();
+		--count;
+		for(size_t j = (i + 1) & mask; slots[j]; j = (j + 1) & mask) {
+			size_t k = ideal(KeyOf{}(*slots[j]));
+			if(i < j ? (i < k && k <= j) : (i < k || k <= j))
+				continue;
+			slots[i] = std::move(slots[j]);
+			slots[j].reset();
+			i = j;
+		}
+		return true;
+	}
+	
+	void clear() {
+		slots.clear();
+		count = 0;
+	}
+	
+	FlatHashIterator<std::optional<T> const> begin() const {
+		return {slots.data(), slots.data() + slots.size()};
+	}
+	
+	FlatHashIterator<std::optional<T> const> end() const {
+		return {slots.data() + slots.size(), slots.data() + slots.size()};
+	}
+};
+
+template<typename T, typename Hash = std::hash<T>, typename Equal = std::equal_to<>>
+class FlatHashSet : public FlatHashTable<T, KeyOfSelf, Hash, Equal> {
+public:
+	using value_type = T;
+	
+	explicit FlatHashSet(Hash hash = {}, Equal equal = {}, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+		: FlatHashTable<T, KeyOfSelf, Hash, Equal>(std::move(hash), std::move(equal), resource) {}
+	
+	template<typename U>
+	std::pair<T const*, bool> insert(U&& value) {
+		return this->emplace_key(value, std::forward<U>(value));
+	}
+};
+
+// the keys must not be modified through the iterators, the order of iteration is unspecified
+template<typename K, typename V, typename Hash = std::hash<K>, typename Equal = std::equal_to<>>
+class FlatHashMap : public FlatHashTable<std::pair<K, V>, KeyOfFirst, Hash, Equal> {
+public:
+	using key_type = K;
+	using mapped_type = V;
+	using value_type = std::pair<K, V>;
+	
+	explicit FlatHashMap(Hash hash = {}, Equal equal = {}, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+		: FlatHashTable<std::pair<K, V>, KeyOfFirst, Hash, Equal>(std::move(hash), std::move(equal), resource) {}
+	
+	// like std::unordered_map::try_emplace, key and args are left untouched if key is present
+	template<typename U, typename... Args>
+	std::pair<V*, bool> try_emplace(U&& key, Args&&... args) {
+		auto [element, inserted] = this->emplace_key(key, std::piecewise_construct, 
+			std::forward_as_tuple(std::forward<U>(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+		return {&element->second, inserted};
+	}
+	
+	template<typename U>
+	V& operator[](U&& key) {
+		return *try_emplace(std::forward<U>(key)).first;
+	}
+	
+	template<typename U>
+	V* find(U const& key) {
+		return const_cast<V*>(std::as_const(*this).find(key));
+	}
+	
+	template<typename U>
+	V const* find(U const& key) const {
+		if(!this->count)
+			return nullptr;
+		auto& slot = this->slots[this->probe(key)];
+		return slot ? &slot->second : nullptr;
+	}
+	
+	FlatHashIterator<std::optional<value_type>> begin() {
+		return {this->slots.data(), this->slots.data() + this->slots.size()};
+	}
+	
+	FlatHashIterator<std::optional<value_type>> end() {
+		return {this->slots.data() + this->slots.size(), this->slots.data() + this->slots.size()};
+	}
+	
+	using FlatHashTable<std::pair<K, V>, KeyOfFirst, Hash, Equal>::begin;
+	using FlatHashTable<std::pair<K, V>, KeyOfFirst, Hash, Equal>::end;
+};
+
+// remembers only the last capacity distinct elements inserted, for distinct over endless streams
+template<typename T, typename Hash = std::hash<T>, typename Equal = std::equal_to<>>
+class RecentSet {
+	FlatHashSet<T, Hash, Equal> set;
+	std::pmr::vector<T> recent; // ring buffer in insertion order
+	size_t capacity, oldest;
+	
+public:
+	explicit RecentSet(size_t capacity, Hash hash = {}, Equal equal = {}, 
+		std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+		: set(std::move(hash), std::move(equal), resource), recent(resource), capacity(std::max(capacity, size_t(1))), oldest(0) {
+		set.reserve(this->capacity);
+		recent.reserve(this->capacity);
+	}
+	
+	size_t size() const {
+		return set.size();
+	}
+	
+	template<typename U>
+	std::pair<T const*, bool> insert(U&& value) {
+		if(set.contains(value))
+			return {nullptr, false};
+		if(recent.size() == capacity) {
+			set.erase(recent[oldest]);
+			recent[oldest] = value;
+			oldest = (oldest + 1) % capacity;
+		} else {
+			recent.push_back(value);
+		}
+		return set.insert(std::forward<U>(value));
+	}
+};
+
+// invokes F on the elements that buffered_t<Stream> refers to
+template<typename Stream, typename F>
+struct Unbuffered {
+	F f;
+	
+	template<typename... T>
+	decltype(auto) operator()(T const&... elements) const {
+		return std::invoke(f, from_buffered<Stream>(elements)...);
+	}
+};
+
+template<typename T, typename = void>
+struct is_hashable : std::false_type {};
+
+template<typename T>
+struct is_hashable<T, std::enable_if_t<std::is_default_constructible_v<std::hash<T>>>> : std::true_type {};
+
+template<typename T>
+constexpr bool is_hashable_v = is_hashable<T>::value;
+
+// Set is FlatHashSet, RecentSet or std::set of buffered_t<Stream>
+template<typename Stream, typename Set>
+struct DistinctStream {
+	using value_type = value_t<Stream>;
+	static constexpr bool stable_front = has_stable_front_v<Stream>;
+	
+	Stream stream;
+	Set set;
+	
+	DistinctStream(Stream stream, Set set) 
+		: stream(std::move(stream)), set(std::move(set)) {}
+	
+	decltype(auto) front() {
+		return stream.front();
+	}
+	
+	bool next() {
+		while(stream.next())
+			if(set.insert(to_buffered<Stream>(stream.front())).second)
+				return true;
+		return false;
+	}
+	
+	template<typename Sink>
+	bool for_each_until(Sink&& sink) {
+		return push_until(stream, [&](auto&& value) {
+			return !set.insert(to_buffered<Stream>(value)).second || std::invoke(sink, std::forward<decltype(value)>(value));
+		});
+	}
+	
+	size_t buffered() const {
+		return set.size();
+	}
+	
+	bool endless() const {
+		return stream.endless();
+	}
+	
+	Buildable;
+};
+
+// drops the elements equal to the one before them, on sorted streams it keeps one of each value
+template<typename Stream, typename Equal>
+struct DistinctAdjacentStream {
+	using value_type = value_t<Stream>;
+	static constexpr bool stable_front = has_stable_front_v<Stream>;
+	
+	Stream stream;
+	Equal equal;
+	std::optional<buffered_t<Stream>> last;
+	
+	DistinctAdjacentStream(Stream stream, Equal equal) 
+		: stream(std::move(stream)), equal(std::move(equal)) {}
+	
+	decltype(auto) front() {
+		return stream.front();
+	}
+	
+	bool next() {
+		while(stream.next())
+			if(accept(stream.front()))
+				return true;
+		return false;
+	}
+	
+	template<typename Sink>
+	bool for_each_until(Sink&& sink) {
+		return push_until(stream, [&](auto&& value) {
+			return !accept(value) || std::invoke(sink, std::forward<decltype(value)>(value));
+		});
+	}
+	
+	bool endless() const {
+		return stream.endless();
+	}
+	
+	Buildable;
+	
+private:
+	template<typename T>
+	bool accept(T& value) {
+		if(last && std::invoke(equal, from_buffered<Stream>(*last), value))
+			return false;
+		last.emplace(to_buffered<Stream>(value));
+		return true;
+	}
+};
+
+template<typename Stream, typename Peeker>
+struct PeekStream {
+	using value_type = value_t<Stream>;
+	static constexpr bool stable_front = has_stable_front_v<Stream>;
+	
+	Stream stream;
+	Peeker peeker;
+	
+	constexpr PeekStream(Stream stream, Peeker peeker) 
+		: stream(std::move(stream)), peeker(std::move(peeker)) {}
+	
+	constexpr decltype(auto) front() {
+		return stream.front();
+	}
+	
+	constexpr bool next() {
+		return stream.next() ? std::invoke(peeker, stream.front()), true : false;
+	}
+	
+	template<typename Sink>
+	constexpr bool for_each_until(Sink&& sink) {
+		return push_until(stream, [&](auto&& value) {
+			return std::invoke(peeker, value), std::invoke(sink, std::forward<decltype(value)>(value));
+		});
+	}
+	
+	constexpr void demand(size_t n) {
+		hint_demand(stream, n);
+	}
+	
+	constexpr bool endless() const {
+		return stream.endless();
+	}
+	
+	Buildable;
+};
+
+template<typename Stream>
+struct MakeEndlessStream {
+	using value_type = value_t<Stream>;
+	static constexpr bool stable_front = has_stable_front_v<Stream>;
+	
+	Stream stream;
+	
+	constexpr MakeEndlessStream(Stream stream) 
+		: stream(std::move(stream)) {}
+	
+	constexpr decltype(auto) front() {
+		return stream.front();
+	}
+	
+	constexpr bool next() {
+		return stream.next();
+	}
+	
+	template<typename Sink>
+	constexpr bool for_each_until(Sink&& sink) {
+		return push_until(stream, sink);
+	}
+	
+	constexpr bool endless() const {
+		return true;
+	}
+	
+	Buildable;
+};
+
+template<typename Stream>
+struct TailRepeatStream {
+	using value_type = remove_optional_t<value_t<Stream>>;
+	
+	Stream stream;
+	bool remaining;
+	std::optional<value_type> cache;
+	
+	TailRepeatStream(Stream stream) 
+		: stream(std::move(stream)), cache(), remaining(true) {}
+	
+	decltype(auto) front() {
+		return remaining ? (cache = stream.front()).value() : cache.value();
+	}
+	
+	bool next() {
+		if(!stream.next()) 
+			remaining = false;
+		return true;
+	}
+	
+	bool endless() const {
+		return true;
+	}
+	
+	Buildable;
+};
+
+template<typename Stream>
+struct LoopStream {
+	using value_type = value_t<Stream>;
+	
+	Stream stream, cache;
+	
+	LoopStream(Stream stream) 
+		: stream(stream), cache(std::move(stream)) {}
+	
+	decltype(auto) front() {
+		return stream.front();
+	}
+	
+	bool next() {
+		while(!stream.next())
+			stream = cache;
+		return true;
+	}
+	
+	template<typename Sink>
+	bool for_each_until(Sink&& sink) {
+		while(push_until(stream, sink))
+			stream = cache;
+		return false;
+	}
+	
+	bool endless() const {
+		return true;
+	}
+	
+	Buildable;
+};
+
+template<typename Stream>
+struct EndlessFlatStream {
+	using value_type = value_t<value_t<Stream>>;
+	
+	Stream stream;
+	bool remaining;
+	
+	EndlessFlatStream(Stream stream) 
+		: stream(std::move(stream)), remaining(false) {}
+	
+	decltype(auto) front() {
+		return stream.front().front();
+	}
+	
+	bool next() {
+		return (remaining && stream.front().next()) || ((remaining = (remaining = false, stream.next())) && stream.front().next());
+	}
+	
+	bool endless() const {
+		return true; // depending on what the stream contains 
+	}
+	
+	Buildable;
+};
+
+// holds one inner stream at a time, moved out of the outer stream
+template<typename Stream>
+struct FlatStream {
+	using value_type = value_t<value_t<Stream>>;
+	
+	Stream stream;
+	std::optional<value_t<Stream>> inner;
+	size_t limit; // the demand left, passed to each inner stream
+	
+	FlatStream(Stream stream) 
+		: stream(std::move(stream)), limit(-1) {}
+	
+	decltype(auto) front() {
+		return inner->front();
+	}
+	
+	bool next() {
+		while(!inner || !inner->next()) {
+			if(!stream.next())
+				return inner.reset(), false;
+			open(take_front(stream));
+		}
+		limit -= limit != size_t(-1);
+		return true;
+	}
+	
+	template<typename Sink>
+	bool for_each_until(Sink&& sink) {
+		auto counted = [&](auto&& value) {
+			limit -= limit != size_t(-1);
+			return std::invoke(sink, std::forward<decltype(value)>(value));
+		};
+		if(inner && !push_until(*inner, counted))
+			return false;
+		if(!push_until(stream, [&](auto&& value) {
+			open(std::forward<decltype(value)>(value));
+			return push_until(*inner, counted);
+		}))
+			return false;
+		return inner.reset(), true;
+	}
+	
+	void demand(size_t n) {
+		limit = std::min(limit, n);
+	}
+	
+	bool endless() const {
+		return stream.endless() || (inner && inner->endless());
+	}
+	
+	Buildable;
+	
+private:
+	template<typename Inner>
+	void open(Inner&& value) {
+		inner.emplace(std::forward<Inner>(value));
+		throw_if_endless(*inner);
+		if(limit != size_t(-1))
+			hint_demand(*inner, limit);
+	}
+};
+
+// the streams are kept in a flat tuple, the active one is selected through a table indexed by its position
+template<typename StreamA, typename ...Streams>
+struct JoinStreams {
+	static_assert((std::is_convertible_v<value_t<Streams>, value_t<StreamA>> && ...));
+	using value_type = value_t<StreamA>; 
+	// the reference is kept only if all the streams agree on it
+	using reference = std::conditional_t<std::is_lvalue_reference_v<reference_t<StreamA>> 
+		&& (std::is_same_v<reference_t<StreamA>, reference_t<Streams>> && ...), reference_t<StreamA>, value_type>;
+	static constexpr bool stable_front = has_stable_front_v<StreamA> && (has_stable_front_v<Streams> && ...);
+	static constexpr size_t count = 1 + sizeof...(Streams);
+	
+	std::tuple<StreamA, Streams...> streams;
+	size_t active;
+	
+	JoinStreams(StreamA streamA, Streams... streams) 
+		: streams(std::move(streamA), std::move(streams)...), active(0) {}
+	
+	reference front() {
+		return visit<reference>([](auto& stream) -> reference { return stream.front(); });
+	}
+	
+	bool next() {
+		for(; active != count; ++active)
+			if(visit<bool>([](auto& stream) { return stream.next(); }))
+				return true;
+		return false;
+	}
+	
+	template<typename Sink>
+	bool for_each_until(Sink&& sink) {
+		return push_from(sink, std::make_index_sequence<count>{});
+	}
+	
+	template<bool S = is_sized_v<StreamA> && (is_sized_v<Streams> && ...), typename = std::enable_if_t<S>>
+	size_t size() const {
+		return size_from(std::make_index_sequence<count>{});
+	}
+	
+	template<bool R = is_sized_v<StreamA> && (is_sized_v<Streams> && ...) 
+		&& is_random_access_v<StreamA> && (is_random_access_v<Streams> && ...), typename = std::enable_if_t<R>>
+	void advance(size_t n) {
+		for(; active != count; ++active) {
+			size_t rest = visit<size_t>([](auto& stream) { return stream.size(); });
+			visit<bool>([n = std::min(n, rest)](auto& stream) { return stream.advance(n), true; });
+			if(n < rest)
+				return;
+			n -= rest;
+		}
+	}
+	
+	void demand(size_t n) {
+		std::apply([n](auto&... streams) { (hint_demand(streams, n), ...); }, streams);
+	}
+	
+	bool endless() const {
+		return std::apply([](auto const&... streams){ return (streams.endless() || ...); }, streams);
+	}
+	
+	Buildable;
+	
+private:
+	template<typename R, typename F>
+	R visit(F f) {
+		return visit<R>(f, std::make_index_sequence<count>{});
+	}
+	
+	template<typename R, typename F, size_t ...I>
+	R visit(F& f, std::index_sequence<I...>) {
+		using Streams_ = std::tuple<StreamA, Streams...>;
+		static constexpr R (*table[])(Streams_&, F&) = { [](Streams_& streams, F& f) -> R { return f(std::get<I>(streams)); }... };
+		return table[active](streams, f);
+	}
+	
+	template<typename Sink, size_t ...I>
+	bool push_from(Sink& sink, std::index_sequence<I...>) {
+		return ((I < active || (push_until(std::get<I>(streams), sink) && (active = I + 1, true))) && ...);
+	}
+	
+	template<size_t ...I>
+	size_t size_from(std::index_sequence<I...>) const {
+		return ((I < active ? 0 : std::get<I>(streams).size()) + ...);
+	}
+};
+
+template<typename Pred, typename ...Streams>
+struct CombineStreams {
+	using result_type = std::invoke_result_t<Pred&, reference_t<Streams>...>;
+	static constexpr bool filtering = is_optional_v<result_type>;
+	// lvalue references returned by pred are kept as pointers instead of copies,
+	// only if front() of every stream is an lvalue too, a reference into a temporary would dangle
+	static constexpr bool referencing = !filtering && std::is_lvalue_reference_v<result_type>
+		&& (std::is_lvalue_reference_v<reference_t<Streams>> && ...);
+	using value_type = std::remove_cv_t<remove_optional_t<std::remove_cv_t<std::remove_reference_t<result_type>>>>;
+	// trivially copyable results are assigned to a plain cache instead of an optional
+	static constexpr bool direct = !referencing && is_blockable_v<value_type> && std::is_assignable_v<value_type&, value_type>;
+	
+	Pred pred;
+	std::conditional_t<referencing, std::remove_reference_t<result_type>*, 
+		std::conditional_t<direct, value_type, std::optional<value_type>>> cache_value{};
+	std::tuple<Streams...> streams;
+	
+	CombineStreams(Pred pred, Streams... streams) 
+		: pred(std::move(pred)), streams(std::move(streams)...) {}
+	
+	decltype(auto) front() {
+		if constexpr(direct)
+			return (cache_value);
+		else
+			return *cache_value;
+	}
+	
+	template<bool R = referencing, typename = std::enable_if_t<!R>>
+	value_type take_front() {
+		if constexpr(direct)
+			return cache_value;
+		else
+			return *std::move(cache_value);
+	}
+	
+	// an empty result of pred skips the elements, like map
+	bool next() {
+		return std::apply([this](auto&... streams) {
+			if constexpr(filtering) {
+				while((streams.next() && ...))
+					if(auto result = std::invoke(pred, streams.front()...))
+						return cache(*std::move(result)), true;
+				return false;
+			} else if constexpr(referencing) {
+				return (streams.next() && ...) && (cache_value = std::addressof(std::invoke(pred, streams.front()...)));
+			} else {
+				return (streams.next() && ...) && (cache(std::invoke(pred, streams.front()...)), true);
+			}
+		}, streams);
+	}
+	
+	template<typename T>
+	void cache(T&& value) {
+		if constexpr(direct)
+			cache_value = std::forward<T>(value);
+		else
+			cache_value.emplace(std::forward<T>(value));
+	}
+	
+	// the results go to sink directly instead of through the cache
+	template<typename Sink>
+	bool for_each_until(Sink&& sink) {
+		return std::apply([&](auto&... streams) {
+			while((streams.next() && ...)) {
+				if constexpr(filtering) {
+					if(auto result = std::invoke(pred, streams.front()...); result && !std::invoke(sink, *std::move(result)))
+						return false;
+				} else {
+					if(!std::invoke(sink, std::invoke(pred, streams.front()...)))
+						return false;
+				}
+			}
+			return true;
+		}, streams);
+	}
+	
+	template<bool S = !filtering && (is_sized_v<Streams> && ...), typename = std::enable_if_t<S>>
+	size_t size() const {
+		return std::apply([](auto const&... streams) { return std::min({streams.size()...}); }, streams);
+	}
+	
+	template<bool R = !filtering && (is_random_access_v<Streams> && ...), typename = std::enable_if_t<R>>
+	void advance(size_t n) {
+		std::apply([n](auto&... streams) { (streams.advance(n), ...); }, streams);
+	}
+	
+	template<bool F = filtering, typename = std::enable_if_t<!F>>
+	void demand(size_t n) {
+		std::apply([n](auto&... streams) { (hint_demand(streams, n), ...); }, streams);
+	}
+	
+	bool endless() const {
+		return std::apply([](auto const&... streams){ return (streams.endless() && ...); }, streams);
+	}
+	
+	Buildable;
+};
+
+// a tournament tree over the heads of k sorted inputs, an empty head loses to any other one
+// ties go to the lower index, which keeps the merge stable
+template<typename Head, typename Compare>
+class Tournament {
+	std::vector<Head> heads; // padded to a power of two
+	std::vector<size_t> tree; // tree[1] is the winner, the leaves start at tree[heads.size()]
+	Compare compare;
+	
+	size_t better(size_t a, size_t b) {
+		if(!heads[b])
+			return a;
+		if(!heads[a])
+			return b;
+		return std::invoke(compare, *heads[b], *heads[a]) ? b : a;
+	}
+	
+public:
+	Tournament(size_t k, Compare compare) : compare(std::move(compare)) {
+		size_t n = 1;
+		while(n < k)
+			n *= 2;
+		heads.resize(n);
+		tree.resize(2 * n);
+	}
+	
+	Head& head(size_t i) {
+		return heads[i];
+	}
+	
+	size_t winner() const {
+		return tree[1];
+	}
+	
+	void build() {
+		size_t n = heads.size();
+		for(size_t i = 0; i != n; ++i)
+			tree[n + i] = i;
+		for(size_t node = n - 1; node > 0; --node)
+			tree[node] = better(tree[2 * node], tree[2 * node + 1]);
+	}
+	
+	// after head(i) changed
+	void replay(size_t i) {
+		for(size_t node = (heads.size() + i) / 2; node > 0; node /= 2)
+			tree[node] = better(tree[2 * node], tree[2 * node + 1]);
+	}
+};
+
+// the heads of stable streams are pointers to their fronts, others are copied out
+template<typename Stream, typename T>
+using merge_head_t = std::conditional_t<has_stable_front_v<Stream> 
+	&& std::is_same_v<std::remove_cv_t<std::remove_reference_t<reference_t<Stream>>>, T>,
+	std::remove_reference_t<reference_t<Stream>>*, std::optional<T>>;
+
+template<typename Head, typename Stream>
+void refill_head(Head& head, Stream& stream) {
+	if(!stream.next())
+		head = Head();
+	else if constexpr(std::is_pointer_v<Head>)
+		head = std::addressof(stream.front());
+	else
+		head.emplace(take_front(stream));
+}
+
+// k-way merge of sorted streams of different types
+template<typename Compare, typename StreamA, typename ...Streams>
+struct MergeStreams {
+	using value_type = value_t<StreamA>;
+	static_assert((std::is_convertible_v<value_t<Streams>, value_type> && ...));
+	using head_type = std::conditional_t<(std::is_same_v<merge_head_t<StreamA, value_type>, 
+		merge_head_t<Streams, value_type>> && ...), merge_head_t<StreamA, value_type>, std::optional<value_type>>;
+	static constexpr bool stable_front = std::is_pointer_v<head_type>;
+	
+	std::tuple<StreamA, Streams...> streams;
+	Tournament<head_type, Compare> tournament;
+	bool started;
+	
+	MergeStreams(Compare compare, StreamA streamA, Streams... streams) 
+		: streams(std::move(streamA), std::move(streams)...), tournament(1 + sizeof...(Streams), std::move(compare)), started(false) {}
+	
+	decltype(auto) front() {
+		return *tournament.head(tournament.winner());
+	}
+	
+	bool next() {
+		if(!started) {
+			started = true;
+			std::apply([this](auto&... streams) { 
+				size_t i = 0;
+				(refill(tournament.head(i++), streams), ...); 
+			}, streams);
+			tournament.build();
+		} else {
+			size_t i = tournament.winner();
+			refill_at(i, std::make_index_sequence<1 + sizeof...(Streams)>());
+			tournament.replay(i);
+		}
+		return bool(tournament.head(tournament.winner()));
+	}
+	
+	// each input yields at most n elements
+	void demand(size_t n) {
+		std::apply([n](auto&... streams) { (hint_demand(streams, n), ...); }, streams);
+	}
+	
+	bool endless() const {
+		return std::apply([](auto const&... streams){ return (streams.endless() || ...); }, streams);
+	}
+	
+	Buildable;
+	
+private:
+	template<typename Stream>
+	static void refill(head_type& head, Stream& stream) {
+		refill_head(head, stream);
+	}
+	
+	template<size_t... I>
+	void refill_at(size_t i, std::index_sequence<I...>) {
+		((i == I ? refill(tournament.head(I), std::get<I>(streams)) : void()), ...);
+	}
+};
+
+// k-way merge of sorted streams of the same type, for many inputs such as the outputs of shards
+template<typename Compare, typename Stream>
+struct MergeStreamVector {
+	using value_type = value_t<Stream>;
+	using head_type = merge_head_t<Stream, std::remove_cv_t<std::remove_reference_t<value_type>>>;
+	static constexpr bool stable_front = std::is_pointer_v<head_type>;
+	
+	std::vector<Stream> streams;
+	Tournament<head_type, Compare> tournament;
+	bool started;
+	
+	MergeStreamVector(Compare compare, std::vector<Stream> streams) 
+		: streams(std::move(streams)), tournament(this->streams.size(), std::move(compare)), started(false) {}
+	
+	decltype(auto) front() {
+		return *tournament.head(tournament.winner());
+	}
+	
+	bool next() {
+		if(!started) {
+			started = true;
+			for(size_t i = 0; i != streams.size(); ++i)
+				refill_head(tournament.head(i), streams[i]);
+			tournament.build();
+		} else {
+			size_t i = tournament.winner();
+			refill_head(tournament.head(i), streams[i]);
+			tournament.replay(i);
+		}
+		return bool(tournament.head(tournament.winner()));
+	}
+	
+	void demand(size_t n) {
+		for(auto& stream : streams)
+			hint_demand(stream, n);
+	}
+	
+	bool endless() const {
+		return std::any_of(streams.begin(), streams.end(), [](Stream const& stream) { return stream.endless(); });
+	}
+	
+	Buildable;
+};
+
+// the elements of an owned vector, such as a shard of partition
+template<typename T>
+struct VectorStream {
+	using value_type = T;
+	static constexpr bool stable_front = true;
+	
+	std::vector<T> elements;
+	size_t current;
+	
+	VectorStream(std::vector<T> elements) : elements(std::move(elements)), current(0) {}
+	
+	T& front() {
+		return elements[current - 1];
+	}
+	
+	bool next() {
+		return current != elements.size() && (++current, true);
+	}
+	
+	template<typename Sink>
+	bool for_each_until(Sink&& sink) {
+		while(current != elements.size())
+			if(!std::invoke(sink, elements[current++]))
+				return false;
+		return true;
+	}
+	
+	size_t size() const {
+		return elements.size() - current;
+	}
+	
+	void advance(size_t n) {
+		current += std::min(n, size());
+	}
+	
+	bool endless() const {
+		return false;
+	}
+	
+	Buildable;
+};
+
+// the elements of a random access stream at the ascending positions in indices, the other ones are skipped
+template<typename Stream>
+struct IndexedStream {
+	using value_type = value_t<Stream>;
+	static constexpr bool stable_front = has_stable_front_v<Stream>;
+	
+	Stream stream;
+	std::vector<size_t> indices;
+	size_t current, position;
+	
+	IndexedStream(Stream stream, std::vector<size_t> indices) 
+		: stream(std::move(stream)), indices(std::move(indices)), current(0), position(0) {}
+	
+	decltype(auto) front() {
+		return stream.front();
+	}
+	
+	bool next() {
+		if(current == indices.size())
+			return false;
+		size_t index = indices[current++];
+		stream.advance(index - position);
+		position = index + 1;
+		return stream.next();
+	}
+	
+	size_t size() const {
+		return indices.size() - current;
+	}
+	
+	void advance(size_t n) {
+		current += std::min(n, size());
+	}
+	
+	bool endless() const {
+		return false;
+	}
+	
+	Buildable;
+};
+
+// the elements of the streams one after another, for many inputs such as the outputs of shards
+template<typename Stream>
+struct GatherStream {
+	using value_type = value_t<Stream>;
+	static constexpr bool stable_front = has_stable_front_v<Stream>;
+	
+	std::vector<Stream> streams;
+	size_t active;
+	
+	GatherStream(std::vector<Stream> streams) : streams(std::move(streams)), active(0) {}
+	
+	decltype(auto) front() {
+		return streams[active].front();
+	}
+	
+	bool next() {
+		for(; active != streams.size(); ++active)
+			if(streams[active].next())
+				return true;
+		return false;
+	}
+	
+	template<typename Sink>
+	bool for_each_until(Sink&& sink) {
+		for(; active != streams.size(); ++active)
+			if(!push_until(streams[active], sink))
+				return false;
+		return true;
+	}
+	
+	template<bool S = is_sized_v<Stream>, typename = std::enable_if_t<S>>
+	size_t size() const {
+		size_t result = 0;
+		for(size_t i = active; i != streams.size(); ++i)
+			result += streams[i].size();
+		return result;
+	}
+	
+	template<bool R = is_sized_v<Stream> && is_random_access_v<Stream>, typename = std::enable_if_t<R>>
+	void advance(size_t n) {
+		for(; active != streams.size(); ++active) {
+			size_t rest = streams[active].size();
+			streams[active].advance(std::min(n, rest));
+			if(n < rest)
+				return;
+			n -= rest;
+		}
+	}
+	
+	void demand(size_t n) {
+		for(auto& stream : streams)
+			hint_demand(stream, n);
+	}
+	
+	bool endless() const {
+		return std::any_of(streams.begin(), streams.end(), [](Stream const& stream) { return stream.endless(); });
+	}
+	
+	Buildable;
+};
+
+// which elements of two sorted streams a set operation keeps, as in the std algorithms of the same names
+enum set_operation_keep {
+	keep_only_a = 1,
+	keep_only_b = 2,
+	keep_both = 4, // the one from StreamA
+};
+
+template<int Keep, typename StreamA, typename StreamB, typename Compare>
+struct SetOperationStream {
+	static_assert(std::is_convertible_v<value_t<StreamB>, value_t<StreamA>>);
+	using value_type = value_t<StreamA>;
+	static constexpr bool stable_front = has_stable_front_v<StreamA> && has_stable_front_v<StreamB>;
+	
+	StreamA streamA;
+	StreamB streamB;
+	Compare compare;
+	bool hasA, hasB, needA, needB, B;
+	
+	SetOperationStream(StreamA streamA, StreamB streamB, Compare compare) 
+		: streamA(std::move(streamA)), streamB(std::move(streamB)), compare(std::move(compare)),
+		hasA(false), hasB(false), needA(true), needB(true), B(false) {}
+	
+	decltype(auto) front() {
+		return B ? streamB.front() : streamA.front();
+	}
+	
+	bool next() {
+		if(needA)
+			hasA = streamA.next(), needA = false;
+		if(needB)
+			hasB = streamB.next(), needB = false;
+		for(;;) {
+			if(!hasA)
+				return hasB && (Keep & keep_only_b) && (B = needB = true);
+			if(!hasB)
+				return (Keep & keep_only_a) && (B = false, needA = true);
+			if(std::invoke(compare, streamA.front(), streamB.front())) {
+				if constexpr((Keep & keep_only_a) != 0)
+					return B = false, needA = true;
+				hasA = streamA.next();
+			} else if(std::invoke(compare, streamB.front(), streamA.front())) {
+				if constexpr((Keep & keep_only_b) != 0)
+					return B = needB = true;
+				hasB = streamB.next();
+			} else {
+				if constexpr((Keep & keep_both) != 0)
+					return B = false, needA = needB = true;
+				hasA = streamA.next();
+				hasB = streamB.next();
+			}
+		}
+	}
+	
+	bool endless() const {
+		if constexpr(Keep == keep_both)
+			return streamA.endless() && streamB.endless();
+		else if constexpr(Keep == keep_only_a)
+			return streamA.endless();
+		else
+			return streamA.endless() || streamB.endless();
+	}
+	
+	Buildable;
+};
+
+[[noreturn]] inline void fail_file([[maybe_unused]] std::string const& path) {
+#ifndef CPP_STREAM_NO_EXCEPTION
+	throw file_exception(path);
+#else
+	std::abort();
+#endif
+}
+
+// the byte channels of serialization, a socket can be wrapped by fdopen
+inline void write_bytes(std::FILE* file, void const* data, size_t size) {
+	if(std::fwrite(data, 1, size, file) != size)
+		fail_file("serialized stream");
+}
+
+inline void write_bytes(std::ostream* out, void const* data, size_t size) {
+	if(!out->write(static_cast<char const*>(data), std::streamsize(size)))
+		fail_file("serialized stream");
+}
+
+inline size_t read_bytes(std::FILE* file, void* data, size_t size) {
+	return std::fread(data, 1, size, file);
+}
+
+inline size_t read_bytes(std::istream* in, void* data, size_t size) {
+	in->read(static_cast<char*>(data), std::streamsize(size));
+	return size_t(in->gcount());
+}
+
+// little endian base 128, at most 10 bytes
+inline size_t encode_varint(char* out, uint64_t value) {
+	size_t size = 0;
+	for(; value >= 0x80; value >>= 7)
+		out[size++] = char(value | 0x80);
+	out[size++] = char(value);
+	return size;
+}
+
+inline void write_varint(std::vector<char>& out, uint64_t value) {
+	char buffer[10];
+	out.insert(out.end(), buffer, buffer + encode_varint(buffer, value));
+}
+
+// fails on truncated input and on values which do not fit in 64 bits
+inline bool read_varint(char const*& data, char const* last, uint64_t& value) {
+	value = 0;
+	for(int shift = 0; data != last && shift < 64; shift += 7) {
+		unsigned char byte = *data++;
+		if(shift == 63 && byte > 1)
+			return false;
+		value |= uint64_t(byte & 0x7F) << shift;
+		if(!(byte & 0x80))
+			return true;
+	}
+	return false;
+}
+
+// encodes T into bytes and back, read returns false on malformed input
+// specialize it for other types with the same two members, bulk types are copied as arrays of their bytes
+template<typename T, typename = void>
+struct Serializer {
+	static_assert(std::is_trivially_copyable_v<T>, "specialize Serializer for elements not trivially copyable");
+	static constexpr bool bulk = true;
+	
+	static void write(std::vector<char>& out, T const& value) {
+		char const* bytes = reinterpret_cast<char const*>(std::addressof(value));
+		out.insert(out.end(), bytes, bytes + sizeof(T));
+	}
+	
+	static bool read(char const*& data, char const* last, T& value) {
+		if(size_t(last - data) < sizeof(T))
+			return false;
+		std::memcpy(std::addressof(value), data, sizeof(T));
+		return data += sizeof(T), true;
+	}
+};
+
+template<typename T, typename = void>
+struct is_bulk_serializable : std::false_type {};
+
+template<typename T>
+struct is_bulk_serializable<T, std::enable_if_t<Serializer<T>::bulk>> : std::true_type {};
+
+template<typename T>
+constexpr bool is_bulk_serializable_v = is_bulk_serializable<T>::value;
+
+// strings and vectors are prefixed by their sizes
+template<typename Char, typename Traits, typename Allocator>
+struct Serializer<std::basic_string<Char, Traits, Allocator>> {
+	static void write(std::vector<char>& out, std::basic_string_view<Char, Traits> value) {
+		write_varint(out, value.size());
+		char const* bytes = reinterpret_cast<char const*>(value.data());
+		out.insert(out.end(), bytes, bytes + value.size() * sizeof(Char));
+	}
+	
+	static bool read(char const*& data, char const* last, std::basic_string<Char, Traits, Allocator>& value) {
+		uint64_t size;
+		if(!read_varint(data, last, size) || size > uint64_t(last - data) / sizeof(Char))
+			return false;
+		value.resize(size_t(size));
+		std::memcpy(value.data(), data, size_t(size) * sizeof(Char));
+		return data += size_t(size) * sizeof(Char), true;
+	}
+};
+
+// read back as std::basic_string, a view cannot own the bytes
+template<typename Char, typename Traits>
+struct Serializer<std::basic_string_view<Char, Traits>> {
+	static void write(std::vector<char>& out, std::basic_string_view<Char, Traits> value) {
+		Serializer<std::basic_string<Char, Traits>>::write(out, value);
+	}
+};
+
+template<typename T, typename Allocator>
+struct Serializer<std::vector<T, Allocator>> {
+	static void write(std::vector<char>& out, std::vector<T, Allocator> const& value) {
+		write_varint(out, value.size());
+		if constexpr(is_bulk_serializable_v<T>) {
+			char const* bytes = reinterpret_cast<char const*>(value.data());
+			out.insert(out.end(), bytes, bytes + value.size() * sizeof(T));
+		} else {
+			for(auto const& element : value)
+				Serializer<T>::write(out, element);
+		}
+	}
+	
+	static bool read(char const*& data, char const* last, std::vector<T, Allocator>& value) {
+		uint64_t size;
+		if(!read_varint(data, last, size))
+			return false;
+		value.clear();
+		if constexpr(is_bulk_serializable_v<T>) {
+			if(size > uint64_t(last - data) / sizeof(T))
+				return false;
+			value.resize(size_t(size));
+			std::memcpy(value.data(), data, size_t(size) * sizeof(T));
+			return data += size_t(size) * sizeof(T), true;
+		} else {
+			// elements may be encoded in no byte at all, the reservation is bounded by the input and grows as they decode
+			if(size > SIZE_MAX)
+				return false;
+			value.reserve(size_t(std::min(size, uint64_t(last - data))));
+			for(uint64_t i = 0; i != size; ++i)
+				if(!Serializer<T>::read(data, last, value.emplace_back()))
+					return false;
+			return true;
+		}
+	}
+};
+
+template<typename ...Ts>
+struct Serializer<std::tuple<Ts...>> {
+	static void write(std::vector<char>& out, std::tuple<Ts...> const& value) {
+		std::apply([&](auto const&... fields) { (Serializer<Ts>::write(out, fields), ...); }, value);
+	}
+	
+	static bool read(char const*& data, char const* last, std::tuple<Ts...>& value) {
+		return std::apply([&](auto&... fields) { return (Serializer<Ts>::read(data, last, fields) && ...); }, value);
+	}
+};
+
+template<typename A, typename B>
+struct Serializer<std::pair<A, B>> {
+	static void write(std::vector<char>& out, std::pair<A, B> const& value) {
+		Serializer<A>::write(out, value.first);
+		Serializer<B>::write(out, value.second);
+	}
+	
+	static bool read(char const*& data, char const* last, std::pair<A, B>& value) {
+		return Serializer<A>::read(data, last, value.first) && Serializer<B>::read(data, last, value.second);
+	}
+};
+
+template<typename T>
+struct Serializer<std::optional<T>> {
+	static void write(std::vector<char>& out, std::optional<T> const& value) {
+		out.push_back(char(bool(value)));
+		if(value)
+			Serializer<T>::write(out, *value);
+	}
+	
+	static bool read(char const*& data, char const* last, std::optional<T>& value) {
+		if(data == last)
+			return false;
+		if(!*data++)
+			return value.reset(), true;
+		return Serializer<T>::read(data, last, value.emplace());
+	}
+};
+
+// the serialized stream is a sequence of frames ended by a zero count, native byte order
+// frame: varint count, varint size in bytes, the encoded count elements
+// a frame of bulk elements is the array itself, which is written and read without encoding
+template<typename T, typename Channel>
+struct FrameWriter {
+	Channel channel;
+	size_t frame_bytes, pending, count;
+	std::vector<char> bytes;
+	
+	FrameWriter(Channel channel, size_t frame_bytes = size_t(1) << 16) 
+		: channel(channel), frame_bytes(std::max(frame_bytes, size_t(1))), pending(0), count(0) {}
+	
+	void push(T const& value) {
+		Serializer<T>::write(bytes, value);
+		++pending;
+		if(bytes.size() >= frame_bytes)
+			flush();
+	}
+	
+	// long blocks are cut into frames written straight from data
+	void push_block(T const* data, size_t n) {
+		static_assert(is_bulk_serializable_v<T>);
+		size_t per_frame = std::max(frame_bytes / sizeof(T), size_t(1));
+		if(pending) {
+			size_t k = std::min(n, per_frame - pending);
+			append(data, k);
+			data += k, n -= k;
+		}
+		for(; n >= per_frame; data += per_frame, n -= per_frame) {
+			write_header(per_frame, per_frame * sizeof(T));
+			write_bytes(channel, data, per_frame * sizeof(T));
+			count += per_frame;
+		}
+		if(n)
+			append(data, n);
+	}
+	
+	void flush() {
+		if(!pending)
+			return;
+		write_header(pending, bytes.size());
+		write_bytes(channel, bytes.data(), bytes.size());
+		count += pending;
+		pending = 0;
+		bytes.clear();
+	}
+	
+	size_t finish() {
+		flush();
+		write_header(0, 0);
+		return count;
+	}
+	
+private:
+	void append(T const* data, size_t n) {
+		char const* first = reinterpret_cast<char const*>(data);
+		bytes.insert(bytes.end(), first, first + n * sizeof(T));
+		pending += n;
+		if(bytes.size() >= frame_bytes)
+			flush();
+	}
+	
+	void write_header(size_t n, size_t size) {
+		char buffer[20];
+		size_t length = encode_varint(buffer, n);
+		if(n)
+			length += encode_varint(buffer + length, size);
+		write_bytes(channel, buffer, length);
+	}
+};
+
+// the elements of a serialized stream read frame by frame, front() is valid until the next frame is read
+template<typename T, typename Channel>
+struct DeserializeStream {
+	using value_type = T;
+	
+	Channel channel;
+	std::vector<T> buffer;
+	std::vector<char> bytes;
+	size_t current;
+	bool finished;
+	
+	DeserializeStream(Channel channel) : channel(channel), current(0), finished(false) {}
+	
+	T& front() {
+		return buffer[current - 1];
+	}
+	
+	bool next() {
+		if(current < buffer.size())
+			return ++current, true;
+		return read_frame();
+	}
+	
+	template<typename Sink, bool B = is_bulk_serializable_v<T>, typename = std::enable_if_t<B>>
+	bool for_each_block(Sink&& sink) {
+		T const* data = buffer.data();
+		if(current < buffer.size() && !std::invoke(sink, data + current, buffer.size() - current))
+			return false;
+		while(read_frame())
+			if(data = buffer.data(), !std::invoke(sink, data, buffer.size()))
+				return false;
+		return true;
+	}
+	
+	bool endless() const {
+		return false;
+	}
+	
+	Buildable;
+	
+private:
+	// the counts are untrusted, every malformed frame fails before anything is allocated for it
+	bool read_frame() {
+		buffer.clear();
+		current = 1;
+		if(finished)
+			return false;
+		uint64_t n, size;
+		if(!read_count(n))
+			fail_file("serialized stream");
+		if(!n)
+			return finished = true, false;
+		if(!read_count(size) || size > SIZE_MAX)
+			fail_file("serialized stream");
+		if constexpr(is_bulk_serializable_v<T>) {
+			if(n > SIZE_MAX / sizeof(T) || size != n * sizeof(T))
+				fail_file("serialized stream");
+			read_chunks(buffer, size_t(n));
+		} else {
+			// elements may be encoded in no byte at all, the reservation is bounded by the input and grows as they decode
+			if(n > SIZE_MAX)
+				fail_file("serialized stream");
+			read_chunks(bytes, size_t(size));
+			char const* data = bytes.data();
+			char const* last = data + bytes.size();
+			buffer.reserve(size_t(std::min(n, size)));
+			for(uint64_t i = 0; i != n; ++i)
+				if(!Serializer<T>::read(data, last, buffer.emplace_back()))
+					fail_file("serialized stream");
+			if(data != last)
+				fail_file("serialized stream");
+		}
+		return true;
+	}
+	
+	// grows the buffer only as the bytes arrive, so a forged size cannot allocate more than the input holds
+	template<typename U>
+	void read_chunks(std::vector<U>& data, size_t n) {
+		constexpr size_t chunk = std::max((size_t(1) << 16) / sizeof(U), size_t(1));
+		data.clear();
+		for(size_t done = 0; done != n;) {
+			size_t k = std::min(n - done, chunk);
+			data.resize(done + k);
+			if(read_bytes(channel, data.data() + done, k * sizeof(U)) != k * sizeof(U))
+				fail_file("serialized stream");
+			done += k;
+		}
+	}
+	
+	bool read_count(uint64_t& value) {
+		char buffer[10];
+		for(size_t i = 0; i != sizeof(buffer); ++i) {
+			if(read_bytes(channel, buffer + i, 1) != 1)
+				return false;
+			if(!(buffer[i] & 0x80)) {
+				char const* data = buffer;
+				return read_varint(data, buffer + i + 1, value);
+			}
+		}
+		return false;
+	}
+};
+
+template<typename Channel>
+struct SerializeBuilder {
+	Channel channel;
+	
+	// returns the count of elements written
+	template<typename Stream>
+	size_t build(Stream stream) {
+		throw_if_endless(stream);
+		using T = std::remove_cv_t<std::remove_reference_t<value_t<Stream>>>;
+		FrameWriter<T, Channel> writer(channel);
+		if constexpr(is_bulk_serializable_v<T> && has_for_each_block_v<Stream>) {
+			stream.for_each_block([&](auto const* data, size_t n) {
+				if constexpr(std::is_same_v<std::remove_cv_t<std::remove_pointer_t<decltype(data)>>, T>)
+					writer.push_block(data, n);
+				else
+					for(size_t i = 0; i != n; ++i)
+						writer.push(data[i]);
+				return true;
+			});
+		} else {
+			push_until(stream, [&](auto&& value) { return writer.push(value), true; });
+		}
+		return writer.finish();
+	}
+};
+
+struct FileCloser {
+	void operator()(std::FILE* file) const {
+		std::fclose(file);
+	}
+};
+
+// a sorted run spilled to a temporary file, which is removed once it is closed
+template<typename T>
+struct SpilledRunStream : DeserializeStream<T, std::FILE*> {
+	std::unique_ptr<std::FILE, FileCloser> file;
+	
+	SpilledRunStream(std::unique_ptr<std::FILE, FileCloser> file)
+		: DeserializeStream<T, std::FILE*>(file.get()), file(std::move(file)) {}
+	
+	Buildable;
+};
+
+// sorts runs of memory_budget bytes of elements, spills them to temporary files and merges them lazily
+// the elements are sorted in memory without spilling if they fit in one run
+template<typename Stream, typename Compare>
+struct ExternalSortStream {
+	using value_type = std::remove_cv_t<std::remove_reference_t<value_t<Stream>>>;
+	using run_type = SpilledRunStream<value_type>;
+	
+	Stream stream;
+	Compare compare;
+	size_t memory_budget;
+	std::pmr::vector<value_type> sorted;
+	size_t current;
+	std::vector<std::unique_ptr<std::FILE, FileCloser>> files;
+	std::vector<size_t> levels;
+	std::optional<MergeStreamVector<Compare, run_type>> merged;
+	
+	ExternalSortStream(Stream stream, Compare compare, size_t memory_budget) 
+		: stream(std::move(stream)), compare(std::move(compare)), memory_budget(memory_budget), 
+		sorted(memory_resource_of(this->stream)), current(0) {}
+	
+	ExternalSortStream(ExternalSortStream&&) = default;
+	ExternalSortStream& operator=(ExternalSortStream&&) = default;
+	
+	decltype(auto) front() {
+		return merged ? merged->front() : sorted[current - 1];
+	}
+	
+	bool next() {
+		if(!current++)
+			sort_runs();
+		return merged ? merged->next() : current - 1 < sorted.size();
+	}
+	
+	size_t buffered() const {
+		return sorted.size();
+	}
+	
+	bool endless() const {
+		return false;
+	}
+	
+	Buildable;
+	
+private:
+	// at most this many runs are merged at once, every fan_in runs of the same level are merged into one of the next level
+	// so that a few hundred temporary files stay open at most
+	static constexpr size_t fan_in = 64;
+	
+	void sort_runs() {
+		throw_if_endless(stream);
+		size_t capacity = std::max(memory_budget / sizeof(value_type), size_t(1));
+		if constexpr(is_sized_v<Stream>)
+			sorted.reserve(std::min(capacity, stream.size()));
+		push_until(stream, [&](auto&& value) {
+			sorted.push_back(std::forward<decltype(value)>(value));
+			if(sorted.size() == capacity)
+				spill();
+			return true;
+		});
+		if(files.empty()) {
+			stable_sort_in(sorted, std::ref(compare));
+			return;
+		}
+		if(!sorted.empty())
+			spill();
+		std::pmr::vector<value_type>(sorted.get_allocator()).swap(sorted);
+		while(files.size() > fan_in)
+			merge_tail(std::min(fan_in, files.size() - fan_in + 1));
+		merged.emplace(open_runs(0, files.size()));
+		files.clear();
+		levels.clear();
+	}
+	
+	// merges the last count runs into one, merging only adjacent runs keeps the sort stable
+	void merge_tail(size_t count) {
+		size_t first = files.size() - count;
+		auto runs = open_runs(first, files.size());
+		auto file = write_run([&](FrameWriter<value_type, std::FILE*>& frames) {
+			while(runs.next())
+				frames.push(runs.front());
+		});
+		size_t level = levels.back() + 1;
+		files.resize(first);
+		levels.resize(first);
+		files.push_back(std::move(file));
+		levels.push_back(level);
+	}
+	
+	MergeStreamVector<Compare, run_type> open_runs(size_t first, size_t last) {
+		std::vector<run_type> runs;
+		for(size_t i = first; i != last; ++i)
+			runs.emplace_back(std::move(files[i]));
+		return MergeStreamVector<Compare, run_type>(compare, std::move(runs));
+	}
+	
+	// the read buffers of the runs merged at once share the budget, a run is read back one frame at a time
+	template<typename Writer>
+	std::unique_ptr<std::FILE, FileCloser> write_run(Writer writer) {
+		std::unique_ptr<std::FILE, FileCloser> file(std::tmpfile());
+		if(!file)
+			fail_file("temporary file");
+		FrameWriter<value_type, std::FILE*> frames(file.get(), std::min(memory_budget / fan_in, size_t(1) << 16));
+		writer(frames);
+		frames.finish();
+		if(std::fflush(file.get()) != 0)
+			fail_file("temporary file");
+		std::rewind(file.get());
+		return file;
+	}
+	
+	void spill() {
+		stable_sort_in(sorted, std::ref(compare));
+		files.push_back(write_run([&](FrameWriter<value_type, std::FILE*>& frames) {
+			if constexpr(is_bulk_serializable_v<value_type>)
+				frames.push_block(sorted.data(), sorted.size());
+			else
+				for(auto& value : sorted)
+					frames.push(value);
+		}));
+		levels.push_back(0);
+		sorted.clear();
+		while(files.size() >= fan_in && levels[files.size() - fan_in] == levels.back())
+			merge_tail(fan_in);
+	}
+};
+
+#ifdef __cpp_lib_ranges
+using iterable_base = std::ranges::view_base;
+#else
+struct iterable_base {};
+#endif
+
+// an iterator range over the source of a from, C++20 uses std::ranges::subrange instead
+template<typename First, typename Last>
+struct IteratorRange {
+	First first;
+	Last last;
+	
+	First begin() const { return first; }
+	Last end() const { return last; }
+	
+	template<typename F = First, typename = std::enable_if_t<is_random_access_iterator_v<F> && std::is_same_v<F, Last>>>
+	size_t size() const { return last - first; }
+};
+
+struct IterableBuilder {
+	// a single pass view, its iterators point to the stream kept in it, which is in an optional only to be assignable
+	template<typename Stream>
+	class Iterable : public iterable_base {
+		std::optional<Stream> stream;
+		
+	public:
+		class Iterator {
+			Stream* stream;
+			bool available;
+			
+		public:
+			using iterator_category = std::input_iterator_tag;
+			using value_type = std::remove_cv_t<std::remove_reference_t<value_t<Stream>>>;
+			using difference_type = std::ptrdiff_t;
+			using pointer = void;
+			using reference = decltype(std::declval<Stream&>().front());
+			
+			Iterator() : stream(nullptr), available(false) {}
+			
+			explicit Iterator(Stream* stream) 
+				: stream(stream), available(stream->next()) {}
+			
+			reference operator*() const {
+				return stream->front();
+			}
+			
+			Iterator& operator++() {
+				available = stream->next();
+				return *this;
+			}
+			
+#ifdef __cpp_lib_ranges
+			void operator++(int) {
+				++*this;
+			}
+			
+			friend bool operator==(Iterator const& iterator, std::default_sentinel_t) {
+				return !iterator.available;
+			}
+#else
+			auto operator++(int) {
+				struct TempIterator {
+					buffered_t<Stream> cache_value;
 					TempIterator(Iterator* iter) 
-						: cache_value(iter->stream->front()) {}
+						: cache_value(to_buffered<Stream>(iter->stream->front())) {}
 					
-					decltype(auto) operator*() const { return cache_value; }
+					decltype(auto) operator*() { return from_buffered<Stream>(cache_value); }
 					
 				} temp(this);
 				++*this;
 				return temp;
 			}
-			friend bool operator==(Iterator left, Iterator right) {
-				return !left.next && right.stream == nullptr;
+			
+			// all the iterators which reached the end are equal
+			friend bool operator==(Iterator const& left, Iterator const& right) {
+				return left.available == right.available;
+			}
+			
+			friend bool operator!=(Iterator const& left, Iterator const& right) {
+				return left.available != right.available;
+			}
+#endif
+		};
+		
+#ifdef __cpp_lib_ranges
+		using sentinel = std::default_sentinel_t;
+#else
+		using sentinel = Iterator;
+#endif
+		
+		Iterable(Stream stream) : stream(std::move(stream)) {}
+		
+		Iterable(Iterable&& other) : stream(std::move(other.stream)) {}
+		
+		Iterable& operator=(Iterable&& other) {
+			if(this != &other) {
+				stream.reset();
+				if(other.stream)
+					stream.emplace(std::move(*other.stream));
+			}
+			return *this;
+		}
+		
+		Iterator begin() { return Iterator(&*stream); }
+		sentinel end() { return sentinel(); }
+		
+		// only before the iteration begins
+		template<bool S = is_sized_v<Stream>, typename = std::enable_if_t<S>>
+		size_t size() const { return stream->size(); }
+	};
+	
+	template<typename Stream>
+	auto build(Stream stream) {
+		return Iterable<Stream>(std::move(stream));
+	}
+	
+	// the iterators of the source are used directly, so random access and contiguous ones keep their fast paths
+	template<typename First, typename Last>
+	auto build(IteratorStream<First, Last> stream) {
+#ifdef __cpp_lib_ranges
+		if constexpr(std::sentinel_for<Last, First>)
+			return std::ranges::subrange(stream.upcoming, stream.last);
+		else
+			return Iterable<IteratorStream<First, Last>>(std::move(stream));
+#else
+		return IteratorRange<First, Last>{stream.upcoming, stream.last};
+#endif
+	}
+};
+
+// kernels over blocks of integers, the independent partial results let the compiler vectorize them
+template<typename Op, template<typename> typename Kernel, typename T>
+constexpr bool is_block_kernel_v = std::is_integral_v<T> && !std::is_same_v<T, bool> 
+	&& (std::is_same_v<Op, Kernel<void>> || std::is_same_v<Op, Kernel<T>>);
+
+template<typename T>
+constexpr T block_sum(T const* data, size_t size) {
+	T lanes[8] = {};
+	size_t i = 0;
+	for(; i + 8 <= size; i += 8)
+		for(size_t j = 0; j != 8; ++j)
+			lanes[j] += data[i + j];
+	for(; i < size; ++i)
+		lanes[0] += data[i];
+	T sum = 0;
+	for(T lane : lanes)
+		sum += lane;
+	return sum;
+}
+
+template<typename T>
+constexpr T block_min(T const* data, size_t size) {
+	T result = data[0];
+	for(size_t i = 1; i != size; ++i)
+		result = data[i] < result ? data[i] : result;
+	return result;
+}
+
+template<typename T>
+constexpr T block_max(T const* data, size_t size) {
+	T result = data[0];
+	for(size_t i = 1; i != size; ++i)
+		result = result < data[i] ? data[i] : result;
+	return result;
+}
+
+template<typename Pred>
+struct ForEachBuilder {
+	Pred pred;
+	
+	constexpr explicit ForEachBuilder(Pred pred) : pred(std::move(pred)) {}
+
+	template<typename Stream>
+	constexpr auto build(Stream stream) {
+		throw_if_endless(stream);
+		push_until(stream, [this](auto&& value) {
+			return std::invoke(pred, std::forward<decltype(value)>(value)), true;
+		});
+	}
+};
+
+template<typename BiPred>
+struct ReduceBuilder {
+	BiPred biPred;
+	
+	constexpr explicit ReduceBuilder(BiPred biPred) : biPred(std::move(biPred)) {}
+	
+	template<typename Stream>
+	constexpr auto build(Stream stream) {
+		throw_if_endless(stream);
+		using T = value_t<Stream>;
+		if constexpr(has_for_each_block_v<Stream> && is_block_kernel_v<BiPred, std::plus, T>) {
+			std::optional<T> result;
+			stream.for_each_block([&](T const* data, size_t size) {
+				if(size) {
+					T sum = block_sum(data, size);
+					result = result ? T(*result + sum) : sum;
+				}
+				return true;
+			});
+			return result;
+		}
+		if(!stream.next())
+			return std::optional<value_t<Stream>>();
+		value_t<Stream> init = stream.front();
+		push_until(stream, [&](auto&& value) {
+			return init = std::invoke(biPred, init, std::forward<decltype(value)>(value)), true;
+		});
+		return std::optional<value_t<Stream>>(std::move(init));
+	}
+};
+
+template<typename Compare>
+struct MinBuilder {
+	Compare compare;
+	
+	constexpr explicit MinBuilder(Compare compare) : compare(std::move(compare)) {}
+	
+	template<typename Stream>
+	constexpr auto build(Stream stream) {
+		throw_if_endless(stream);
+		using T = value_t<Stream>;
+		if constexpr(has_for_each_block_v<Stream> && is_block_kernel_v<Compare, std::less, T>) {
+			std::optional<T> result;
+			stream.for_each_block([&](T const* data, size_t size) {
+				if(size) {
+					T min = block_min(data, size);
+					result = result && *result < min ? *result : min;
+				}
+				return true;
+			});
+			return result;
+		}
+		if(!stream.next())
+			return std::optional<value_t<Stream>>();
+		value_t<Stream> init = stream.front();
+		push_until(stream, [&](auto&& value) {
+			if(!std::invoke(compare, init, value))
+				init = std::forward<decltype(value)>(value);
+			return true;
+		});
+		return std::optional<value_t<Stream>>(std::move(init));
+	}
+};
+
+template<typename Compare>
+struct MaxBuilder {
+	Compare compare;
+	
+	constexpr explicit MaxBuilder(Compare compare) : compare(std::move(compare)) {}
+	
+	template<typename Stream>
+	constexpr auto build(Stream stream) {
+		throw_if_endless(stream);
+		using T = value_t<Stream>;
+		if constexpr(has_for_each_block_v<Stream> && is_block_kernel_v<Compare, std::less, T>) {
+			std::optional<T> result;
+			stream.for_each_block([&](T const* data, size_t size) {
+				if(size) {
+					T max = block_max(data, size);
+					result = result && max < *result ? *result : max;
+				}
+				return true;
+			});
+			return result;
+		}
+		if(!stream.next())
+			return std::optional<value_t<Stream>>();
+		value_t<Stream> init = stream.front();
+		push_until(stream, [&](auto&& value) {
+			if(!std::invoke(compare, value, init))
+				init = std::forward<decltype(value)>(value);
+			return true;
+		});
+		return std::optional<value_t<Stream>>(std::move(init));
+	}
+};
+
+template<typename Compare>
+struct MinMaxBuilder {
+	Compare compare;
+	
+	constexpr explicit MinMaxBuilder(Compare compare) : compare(std::move(compare)) {}
+	
+	template<typename Stream>
+	constexpr auto build(Stream stream) const
+		-> std::optional<std::pair<value_t<Stream>, value_t<Stream>>> {
+		throw_if_endless(stream);
+		using T = value_t<Stream>;
+		if constexpr(has_for_each_block_v<Stream> && is_block_kernel_v<Compare, std::less, T>) {
+			std::optional<std::pair<T, T>> result;
+			stream.for_each_block([&](T const* data, size_t size) {
+				if(size) {
+					T min = block_min(data, size), max = block_max(data, size);
+					if(!result)
+						result.emplace(min, max);
+					else
+						result->first = std::min(result->first, min), result->second = std::max(result->second, max);
+				}
+				return true;
+			});
+			return result;
+		}
+		if(stream.next()) {
+			value_t<Stream> min = stream.front(), max = stream.front();
+			push_until(stream, [&](auto&& value) {
+				if(!std::invoke(compare, min, value))
+					min = value;
+				if(!std::invoke(compare, value, max))
+					max = value;
+				return true;
+			});
+			return std::pair(min, max);
+		}
+		return {};
+	}
+};
+
+template<typename Pred>
+struct AllMatchBuilder {
+	Pred pred;
+	
+	constexpr explicit AllMatchBuilder(Pred pred) : pred(std::move(pred)) {}
+	
+	template<typename Stream>
+	constexpr auto build(Stream stream) {
+		throw_if_endless(stream);
+		return push_until(stream, [this](auto&& value) {
+			return static_cast<bool>(std::invoke(pred, std::forward<decltype(value)>(value)));
+		});
+	}
+};
+
+template<typename Pred>
+struct AnyMatchBuilder {
+	Pred pred;
+	
+	constexpr explicit AnyMatchBuilder(Pred pred) : pred(std::move(pred)) {}
+
+	template<typename Stream>
+	constexpr auto build(Stream stream) {
+		throw_if_endless(stream);
+		return !push_until(stream, [this](auto&& value) {
+			return !std::invoke(pred, std::forward<decltype(value)>(value));
+		});
+	}
+};
+
+template<typename Pred>
+struct NoneMatchBuilder {
+	Pred pred;
+	
+	constexpr explicit NoneMatchBuilder(Pred pred) : pred(std::move(pred)) {}
+
+	template<typename Stream>
+	constexpr auto build(Stream stream) {
+		throw_if_endless(stream);
+		return push_until(stream, [this](auto&& value) {
+			return !std::invoke(pred, std::forward<decltype(value)>(value));
+		});
+	}
+};
+
+template<typename Counter>
+struct CountBuilder {
+	Counter counter;
+	
+	constexpr explicit CountBuilder(Counter counter) : counter(std::move(counter)) {}
+	
+	template<typename Stream>
+	constexpr auto build(Stream stream) {
+		throw_if_endless(stream);
+		if constexpr(is_sized_v<Stream> && std::is_arithmetic_v<Counter>)
+			counter += stream.size();
+		else
+			push_until(stream, [this](auto&&) { return ++counter, true; });
+		return counter;
+	}
+};
+
+// collects the elements into a FlatHashMap from key(element) to Mapped, 
+// the slot of a new key starts as a copy of init, then accumulate(slot, element) is invoked on it
+template<typename Key, typename Mapped, typename Accumulate>
+struct GroupingBuilder {
+	Key key;
+	Mapped init;
+	Accumulate accumulate;
+	
+	GroupingBuilder(Key key, Mapped init, Accumulate accumulate) 
+		: key(std::move(key)), init(std::move(init)), accumulate(std::move(accumulate)) {}
+	
+	template<typename Stream>
+	auto build(Stream stream) {
+		throw_if_endless(stream);
+		FlatHashMap<std::decay_t<std::invoke_result_t<Key&, reference_t<Stream>>>, Mapped> map;
+		push_until(stream, [&](auto&& value) {
+			Mapped& slot = *map.try_emplace(std::invoke(key, value), init).first;
+			std::invoke(accumulate, slot, std::forward<decltype(value)>(value));
+			return true;
+		});
+		return map;
+	}
+};
+
+struct CountingAccumulator {
+	template<typename T>
+	void operator()(size_t& slot, T&&) const {
+		++slot;
+	}
+};
+
+struct AppendingAccumulator {
+	template<typename Container, typename T>
+	void operator()(Container& slot, T&& value) const {
+		slot.push_back(std::forward<T>(value));
+	}
+};
+
+// merges partial results of the accumulators above
+struct SummingCombiner {
+	void operator()(size_t& slot, size_t other) const {
+		slot += other;
+	}
+};
+
+struct ConcatenatingCombiner {
+	template<typename Container>
+	void operator()(Container& slot, Container&& other) const {
+		slot.insert(slot.end(), std::make_move_iterator(other.begin()), std::make_move_iterator(other.end()));
+	}
+};
+
+// slot = op(std::move(slot), value)
+template<typename Op>
+struct FoldingAccumulator {
+	Op op;
+	
+	template<typename Mapped, typename T>
+	void operator()(Mapped& slot, T&& value) {
+		slot = std::invoke(op, std::move(slot), std::forward<T>(value));
+	}
+};
+
+template<typename Key>
+struct GroupByBuilder {
+	Key key;
+	
+	explicit GroupByBuilder(Key key) : key(std::move(key)) {}
+	
+	template<typename Stream>
+	auto build(Stream stream) {
+		using group_type = std::vector<std::remove_cv_t<std::remove_reference_t<value_t<Stream>>>>;
+		return GroupingBuilder(std::ref(key), group_type(), AppendingAccumulator{}).build(std::move(stream));
+	}
+};
+
+// the elements satisfying pred go to first, the others to second, both in their original order
+template<typename Pred>
+struct PartitionByBuilder {
+	Pred pred;
+	
+	explicit PartitionByBuilder(Pred pred) : pred(std::move(pred)) {}
+	
+	template<typename Stream>
+	auto build(Stream stream) {
+		throw_if_endless(stream);
+		using group_type = std::vector<std::remove_cv_t<std::remove_reference_t<value_t<Stream>>>>;
+		std::pair<group_type, group_type> groups;
+		push_until(stream, [&](auto&& value) {
+			(std::invoke(pred, value) ? groups.first : groups.second).push_back(std::forward<decltype(value)>(value));
+			return true;
+		});
+		return groups;
+	}
+};
+
+// passes every element to sink, moving it out of a stream caching its front() instead of copying it
+template<typename Stream, typename Sink>
+void drain(Stream& stream, Sink&& sink) {
+	auto push = [&](auto&& value) { return std::invoke(sink, std::forward<decltype(value)>(value)), true; };
+	if constexpr(has_take_front<Stream>::value && !has_for_each_until<Stream, decltype(push)>::value)
+		while(stream.next())
+			std::invoke(sink, stream.take_front());
+	else
+		push_until(stream, push);
+}
+
+template<typename Container, typename T, typename = void>
+struct has_push_back : std::false_type {};
+
+template<typename Container, typename T>
+struct has_push_back<Container, T, std::void_t<decltype(std::declval<Container&>().push_back(std::declval<T>()))>> : std::true_type {};
+
+template<typename Container, typename T, typename = void>
+struct has_block_insert : std::false_type {};
+
+template<typename Container, typename T>
+struct has_block_insert<Container, T, std::void_t<decltype(std::declval<Container&>().insert(
+	std::declval<Container&>().end(), std::declval<T const*>(), std::declval<T const*>()))>> : std::true_type {};
+
+// appends to the end of a sequence container, or inserts into an associative one
+template<typename Container>
+struct IntoBuilder {
+	Container* container;
+	
+	explicit IntoBuilder(Container& container) : container(std::addressof(container)) {}
+	
+	template<typename Stream>
+	Container& build(Stream stream) {
+		throw_if_endless(stream);
+		if constexpr(is_sized_v<Stream> && has_reserve<Container>::value)
+			container->reserve(container->size() + stream.size());
+		if constexpr(has_for_each_block_v<Stream> && has_block_insert<Container, value_t<Stream>>::value) {
+			stream.for_each_block([this](value_t<Stream> const* data, size_t size) {
+				return container->insert(container->end(), data, data + size), true;
+			});
+		} else {
+			drain(stream, [this](auto&& value) {
+				if constexpr(has_push_back<Container, decltype(value)>::value)
+					container->push_back(std::forward<decltype(value)>(value));
+				else
+					container->insert(std::forward<decltype(value)>(value));
+			});
+		}
+		return *container;
+	}
+};
+
+// the first element of every key is kept
+template<typename Key, typename Value>
+struct ToUnorderedMapBuilder {
+	Key key;
+	Value val;
+	
+	ToUnorderedMapBuilder(Key key, Value val) : key(std::move(key)), val(std::move(val)) {}
+	
+	template<typename Stream>
+	auto build(Stream stream) {
+		throw_if_endless(stream);
+		using K = std::decay_t<std::invoke_result_t<Key&, value_t<Stream>&>>;
+		using V = std::decay_t<std::invoke_result_t<Value&, value_t<Stream>>>;
+		std::unordered_map<K, V> result;
+		if constexpr(is_sized_v<Stream>)
+			result.reserve(stream.size());
+		drain(stream, [&](auto&& value) {
+			K k = std::invoke(key, value);
+			if(result.find(k) == result.end())
+				result.emplace(std::move(k), std::invoke(val, std::forward<decltype(value)>(value)));
+		});
+		return result;
+	}
+};
+
+// splits a stream over its source positions, only for sources with known size and random access 
+// and the element-wise adaptors over them
+template<typename Stream, typename = void>
+struct Splitter {
+	static constexpr bool splittable = false;
+};
+
+template<typename Iterator>
+struct Splitter<IteratorStream<Iterator, Iterator>, std::enable_if_t<is_random_access_iterator_v<Iterator>>> {
+	static constexpr bool splittable = true;
+	
+	static size_t extent(IteratorStream<Iterator, Iterator> const& stream) {
+		return stream.size();
+	}
+	
+	static auto slice(IteratorStream<Iterator, Iterator> const& stream, size_t first, size_t last) {
+		return IteratorStream<Iterator, Iterator>(stream.upcoming + first, stream.upcoming + last, false);
+	}
+};
+
+template<typename Stream>
+struct Splitter<TakeStream<Stream>, std::enable_if_t<is_random_access_v<Stream>>> {
+	static constexpr bool splittable = true;
+	
+	static size_t extent(TakeStream<Stream> const& stream) {
+		return stream.size();
+	}
+	
+	static auto slice(TakeStream<Stream> const& stream, size_t first, size_t last) {
+		Stream inner = stream.stream;
+		inner.advance(first);
+		return TakeStream(std::move(inner), last - first);
+	}
+};
+
+template<typename Stream>
+struct Splitter<SkipStream<Stream>, std::enable_if_t<is_sized_v<Stream> && is_random_access_v<Stream>>> {
+	static constexpr bool splittable = true;
+	
+	static size_t extent(SkipStream<Stream> const& stream) {
+		return stream.size();
+	}
+	
+	static auto slice(SkipStream<Stream> const& stream, size_t first, size_t last) {
+		SkipStream<Stream> inner = stream;
+		inner.advance(first);
+		return TakeStream(std::move(inner.stream), last - first);
+	}
+};
+
+template<typename Stream, typename Pred>
+struct Splitter<FilterStream<Stream, Pred>, std::enable_if_t<Splitter<Stream>::splittable>> {
+	static constexpr bool splittable = true;
+	
+	static size_t extent(FilterStream<Stream, Pred> const& stream) {
+		return Splitter<Stream>::extent(stream.stream);
+	}
+	
+	static auto slice(FilterStream<Stream, Pred> const& stream, size_t first, size_t last) {
+		return FilterStream(Splitter<Stream>::slice(stream.stream, first, last), stream.pred);
+	}
+};
+
+template<typename Stream, typename Pred>
+struct Splitter<MapStream<Stream, Pred>, std::enable_if_t<Splitter<Stream>::splittable>> {
+	static constexpr bool splittable = true;
+	
+	static size_t extent(MapStream<Stream, Pred> const& stream) {
+		return Splitter<Stream>::extent(stream.stream);
+	}
+	
+	static auto slice(MapStream<Stream, Pred> const& stream, size_t first, size_t last) {
+		return MapStream(Splitter<Stream>::slice(stream.stream, first, last), stream.pred);
+	}
+};
+
+template<typename Stream, typename Peeker>
+struct Splitter<PeekStream<Stream, Peeker>, std::enable_if_t<Splitter<Stream>::splittable>> {
+	static constexpr bool splittable = true;
+	
+	static size_t extent(PeekStream<Stream, Peeker> const& stream) {
+		return Splitter<Stream>::extent(stream.stream);
+	}
+	
+	static auto slice(PeekStream<Stream, Peeker> const& stream, size_t first, size_t last) {
+		return PeekStream(Splitter<Stream>::slice(stream.stream, first, last), stream.peeker);
+	}
+};
+
+#ifndef CPP_STREAM_NO_PROFILE
+template<typename Stream>
+struct Splitter<ProfileStream<Stream>, std::enable_if_t<Splitter<Stream>::splittable>> {
+	static constexpr bool splittable = true;
+	
+	static size_t extent(ProfileStream<Stream> const& stream) {
+		return Splitter<Stream>::extent(stream.stream);
+	}
+	
+	static auto slice(ProfileStream<Stream> const& stream, size_t first, size_t last) {
+		auto inner = Splitter<Stream>::slice(stream.stream, first, last);
+		return ProfileStream<decltype(inner)>(std::move(inner), stream.node);
+	}
+};
+#endif
+
+// the positions of sized random access streams are their elements, so they can be sliced together
+template<typename Pred, typename ...Streams>
+struct Splitter<CombineStreams<Pred, Streams...>, std::enable_if_t<(is_sized_v<CombineStreams<Pred, Streams...>> 
+	&& is_random_access_v<CombineStreams<Pred, Streams...>>) && (Splitter<Streams>::splittable && ...)>> {
+	static constexpr bool splittable = true;
+	
+	static size_t extent(CombineStreams<Pred, Streams...> const& stream) {
+		return stream.size();
+	}
+	
+	static auto slice(CombineStreams<Pred, Streams...> const& stream, size_t first, size_t last) {
+		return std::apply([&](auto const&... streams) {
+			return CombineStreams(stream.pred, Splitter<Streams>::slice(streams, first, last)...);
+		}, stream.streams);
+	}
+};
+
+template<typename Stream>
+constexpr bool is_splittable_v = Splitter<Stream>::splittable;
+
+// cuts a splittable stream into consecutive shards over its source positions, no element is copied
+struct SplitBuilder {
+	size_t count;
+	
+	template<typename Stream>
+	auto build(Stream stream) const {
+		static_assert(is_splittable_v<Stream>, "split needs a sized random access source");
+		size_t extent = Splitter<Stream>::extent(stream);
+		std::vector<decltype(Splitter<Stream>::slice(stream, 0, 0))> shards;
+		shards.reserve(count);
+		for(size_t i = 0; i != count; ++i)
+			shards.push_back(Splitter<Stream>::slice(stream, extent * i / count, extent * (i + 1) / count));
+		return shards;
+	}
+};
+
+// sends every element into the shard hasher(element) % count, keeping the order
+// a sized random access stream referring to stable elements is read once for the hashes, 
+// then every shard walks its own copy over its positions, no element is copied
+// other streams are read once and their elements are moved into the buffers of the shards
+template<typename Hasher>
+struct PartitionBuilder {
+	size_t count;
+	Hasher hasher;
+	
+	PartitionBuilder(size_t count, Hasher hasher) : count(count), hasher(std::move(hasher)) {}
+	
+	template<typename Stream>
+	auto build(Stream stream) {
+		throw_if_endless(stream);
+		if constexpr(is_sized_v<Stream> && is_random_access_v<Stream> && has_stable_front_v<Stream> 
+			&& std::is_copy_constructible_v<Stream>) {
+			std::vector<std::vector<size_t>> indices(count);
+			if(count) {
+				Stream scan = stream;
+				size_t position = 0;
+				push_until(scan, [&](auto const& value) {
+					indices[size_t(std::invoke(hasher, value)) % count].push_back(position++);
+					return true;
+				});
 			}
-			friend bool operator!=(Iterator left, Iterator right) {
-				return !(left == right);
+			std::vector<IndexedStream<Stream>> shards;
+			shards.reserve(count);
+			for(auto& shard : indices)
+				shards.emplace_back(stream, std::move(shard));
+			return shards;
+		} else {
+			using T = std::remove_cv_t<std::remove_reference_t<value_t<Stream>>>;
+			std::vector<std::vector<T>> buffers(count);
+			if(count)
+				drain(stream, [&](auto&& value) {
+					size_t i = size_t(std::invoke(hasher, std::as_const(value))) % count;
+					buffers[i].push_back(std::forward<decltype(value)>(value));
+				});
+			std::vector<VectorStream<T>> shards;
+			shards.reserve(count);
+			for(auto& buffer : buffers)
+				shards.emplace_back(std::move(buffer));
+			return shards;
+		}
+	}
+};
+
+#ifndef CPP_STREAM_NO_PARALLEL
+class WorkStealingPool {
+	struct Queue {
+		std::mutex mutex;
+		std::deque<std::function<void()>> tasks;
+	};
+	
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> workers;
+	std::atomic<size_t> pending, upcoming;
+	std::mutex sleep_mutex;
+	std::condition_variable sleeping;
+	bool stop;
+	
+	inline static thread_local WorkStealingPool* owner = nullptr;
+	inline static thread_local size_t owner_index = 0;
+	
+	size_t self() {
+		return owner == this ? owner_index : upcoming.fetch_add(1, std::memory_order_relaxed) % queues.size();
+	}
+	
+	// pops from the back of its own queue, steals from the front of the others
+	bool try_run(size_t index) {
+		std::function<void()> task;
+		for(size_t i = 0; i != queues.size() && !task; ++i) {
+			Queue& queue = *queues[(index + i) % queues.size()];
+			std::lock_guard lock(queue.mutex);
+			if(queue.tasks.empty())
+				continue;
+			if(i == 0) {
+				task = std::move(queue.tasks.back());
+				queue.tasks.pop_back();
+			} else {
+				task = std::move(queue.tasks.front());
+				queue.tasks.pop_front();
 			}
-			decltype(auto) operator*() const {return stream->front();}
-		};
-		Stream stream;
-		Iterable(Stream stream)
-			: stream(stream) {}
-		Iterator begin() { return Iterator(&stream); }
-		Iterator end() { return Iterator(); }
-		
+		}
+		if(!task)
+			return false;
+		pending.fetch_sub(1, std::memory_order_relaxed);
+		task();
+		return true;
+	}
+	
+	void work(size_t index) {
+		owner = this;
+		owner_index = index;
+		for(;;) {
+			if(try_run(index))
+				continue;
+			std::unique_lock lock(sleep_mutex);
+			sleeping.wait(lock, [this]{ return stop || pending.load() != 0; });
+			if(stop)
+				return;
+		}
+	}
+	
+public:
+	explicit WorkStealingPool(size_t threads = std::max(std::thread::hardware_concurrency(), 2u) - 1)
+		: pending(0), upcoming(0), stop(false) {
+		threads = std::max(threads, size_t(1));
+		for(size_t i = 0; i != threads; ++i)
+			queues.push_back(std::make_unique<Queue>());
+		for(size_t i = 0; i != threads; ++i)
+			workers.emplace_back([this, i]{ work(i); });
+	}
+	
+	WorkStealingPool(WorkStealingPool const&) = delete;
+	WorkStealingPool& operator=(WorkStealingPool const&) = delete;
+	
+	~WorkStealingPool() {
+		{
+			std::lock_guard lock(sleep_mutex);
+			stop = true;
+		}
+		sleeping.notify_all();
+		for(auto& worker : workers)
+			worker.join();
+	}
+	
+	size_t size() const {
+		return workers.size();
+	}
+	
+	void submit(std::function<void()> task) {
+		Queue& queue = *queues[self()];
+		{
+			std::lock_guard lock(queue.mutex);
+			queue.tasks.push_back(std::move(task));
+		}
+		pending.fetch_add(1);
+		{
+			std::lock_guard lock(sleep_mutex);
+		}
+		sleeping.notify_one();
+	}
+	
+	// runs body(0) ... body(count - 1) on the pool, the calling thread helps until all of them are done
+	template<typename Body>
+	void parallel_for(size_t count, Body&& body) {
+		std::atomic<size_t> remaining(count);
+#ifndef CPP_STREAM_NO_EXCEPTION
+		std::exception_ptr error;
+		std::mutex error_mutex;
+#endif
+		for(size_t i = 0; i != count; ++i)
+			submit([&, i] {
+#ifndef CPP_STREAM_NO_EXCEPTION
+				try {
+					body(i);
+				} catch(...) {
+					std::lock_guard lock(error_mutex);
+					if(!error)
+						error = std::current_exception();
+				}
+#else
+				body(i);
+#endif
+				remaining.fetch_sub(1, std::memory_order_release);
+			});
+		size_t index = self();
+		while(remaining.load(std::memory_order_acquire))
+			if(!try_run(index))
+				std::this_thread::yield();
+#ifndef CPP_STREAM_NO_EXCEPTION
+		if(error)
+			std::rethrow_exception(error);
+#endif
+	}
+};
+
+inline WorkStealingPool& default_pool() {
+	static WorkStealingPool pool;
+	return pool;
+}
+
+struct parallel_policy {
+	WorkStealingPool* pool = nullptr; // default_pool() if null
+	size_t grain = 4096; // minimal count of source elements per chunk
+	
+	WorkStealingPool& executor() const {
+		return pool ? *pool : default_pool();
+	}
+	
+	size_t chunks(size_t extent) const {
+		return std::max(std::min(extent / std::max(grain, size_t(1)), executor().size() * 4), size_t(1));
+	}
+};
+
+inline constexpr parallel_policy par{};
+
+// runs body(index, slice) for every chunk of stream on the pool, returns the count of chunks
+template<typename Stream, typename Body>
+size_t parallel_slices(parallel_policy const& policy, Stream const& stream, Body&& body) {
+	size_t extent = Splitter<Stream>::extent(stream), chunks = policy.chunks(extent);
+	policy.executor().parallel_for(chunks, [&](size_t i) {
+		body(i, Splitter<Stream>::slice(stream, extent * i / chunks, extent * (i + 1) / chunks));
+	});
+	return chunks;
+}
+
+template<typename Stream, typename Body>
+auto parallel_partials(parallel_policy const& policy, Stream const& stream, Body&& body) {
+	using result_type = decltype(body(Splitter<Stream>::slice(stream, 0, 0)));
+	size_t extent = Splitter<Stream>::extent(stream);
+	std::vector<std::optional<result_type>> partials(policy.chunks(extent));
+	parallel_slices(policy, stream, [&](size_t i, auto slice) {
+		partials[i].emplace(body(std::move(slice)));
+	});
+	return partials;
+}
+
+// sorts the runs of every chunk on the pool, then merges pairs of adjacent runs until one is left, 
+// every merge being split at the same output positions into pieces of about the same length
+template<typename T, typename Less>
+void parallel_sort_in(parallel_policy const& policy, std::pmr::vector<T>& data, Less less, bool stable) {
+	size_t n = data.size(), chunks = policy.chunks(n);
+	if(chunks < 2) {
+		if(stable)
+			stable_sort_in(data, less);
+		else
+			std::sort(data.begin(), data.end(), less);
+		return;
+	}
+	auto resource = data.get_allocator().resource();
+	std::vector<size_t> bounds(chunks + 1);
+	for(size_t i = 0; i <= chunks; ++i)
+		bounds[i] = n * i / chunks;
+	// the resource may not be synchronized, so it is used only on this thread: 
+	// the runs are sorted in buffer, taking the slice of data at the same positions as their scratch
+	std::pmr::vector<T> buffer(std::make_move_iterator(data.begin()), std::make_move_iterator(data.end()), resource);
+	policy.executor().parallel_for(chunks, [&](size_t i) {
+		if(stable && resource == std::pmr::new_delete_resource())
+			std::stable_sort(buffer.begin() + bounds[i], buffer.begin() + bounds[i + 1], less);
+		else if(stable)
+			stable_sort_with(buffer.begin() + bounds[i], buffer.begin() + bounds[i + 1], data.begin() + bounds[i], less);
+		else
+			std::sort(buffer.begin() + bounds[i], buffer.begin() + bounds[i + 1], less);
+	});
+	// the count of elements of a taken before the d-th output of merging a and b, equal elements of a go first
+	auto split = [&](auto a, size_t na, auto b, size_t nb, size_t d) {
+		size_t lo = d > nb ? d - nb : 0, hi = std::min(d, na);
+		while(lo < hi) {
+			size_t i = lo + (hi - lo) / 2, j = d - i;
+			if(j > 0 && !less(b[j - 1], a[i]))
+				lo = i + 1;
+			else
+				hi = i;
+		}
+		return lo;
 	};
-	template<typename Stream>
-	auto build(Stream stream) {
-		return Iterable(std::move(stream));
+	// the splits are found before any piece moves elements out of the runs
+	struct Piece { size_t out, i, j, i1, j1; };
+	auto* from = &buffer;
+	auto* to = &data;
+	for(; bounds.size() > 2; std::swap(from, to)) {
+		std::vector<Piece> pieces;
+		std::vector<size_t> merged;
+		for(size_t r = 0; r + 1 < bounds.size(); r += 2) {
+			size_t first = bounds[r], middle = bounds[r + 1], last = r + 2 < bounds.size() ? bounds[r + 2] : middle;
+			auto a = from->begin() + first, b = from->begin() + middle;
+			size_t na = middle - first, nb = last - middle, parts = std::max((last - first) * chunks / n, size_t(1));
+			for(size_t k = 0, i = 0, d = 0; k != parts; ++k) {
+				size_t d1 = (last - first) * (k + 1) / parts, i1 = split(a, na, b, nb, d1);
+				pieces.push_back({first + d, first + i, middle + d - i, first + i1, middle + d1 - i1});
+				i = i1;
+				d = d1;
+			}
+			merged.push_back(first);
+		}
+		merged.push_back(n);
+		policy.executor().parallel_for(pieces.size(), [&](size_t k) {
+			auto [out, i, j, i1, j1] = pieces[k];
+			auto& in = *from;
+			for(auto it = to->begin() + out; i != i1 || j != j1; ++it)
+				*it = i == i1 || (j != j1 && less(in[j], in[i])) ? std::move(in[j++]) : std::move(in[i++]);
+		});
+		bounds = std::move(merged);
+	}
+	if(from != &data)
+		policy.executor().parallel_for(chunks, [&](size_t i) {
+			std::move(buffer.begin() + n * i / chunks, buffer.begin() + n * (i + 1) / chunks, data.begin() + n * i / chunks);
+		});
+}
+
+// sorts the whole buffer with parallel_sort_in, a demand still keeps only the first elements on the calling thread
+template<typename Stream, typename Compare>
+struct ParallelSortStream : SortStream<Stream, Compare> {
+	parallel_policy policy;
+	
+	ParallelSortStream(Stream stream, Compare compare, parallel_policy policy, bool stable = true) 
+		: SortStream<Stream, Compare>(std::move(stream), std::move(compare), stable), policy(policy) {}
+	
+	bool next() {
+		if(!this->current) {
+			if constexpr(is_sized_v<Stream>)
+				if(this->limit >= this->stream.size())
+					this->limit = -1;
+			if(this->limit == size_t(-1)) {
+				this->current = 1;
+				if constexpr(is_sized_v<Stream>)
+					this->sorted.reserve(this->stream.size());
+				push_until(this->stream, [this](auto&& value) { 
+					return this->sorted.push_back(to_buffered<Stream>(std::forward<decltype(value)>(value))), true; 
+				});
+				parallel_sort_in(policy, this->sorted, [this](auto const& a, auto const& b) { return this->less(a, b); }, this->stable);
+				return !this->sorted.empty();
+			}
+		}
+		return SortStream<Stream, Compare>::next();
 	}
 	
+	Buildable;
 };
 
 template<typename Pred>
-struct ForEachBuilder {
+struct ParallelForEachBuilder {
+	parallel_policy policy;
 	Pred pred;
 	
-	explicit ForEachBuilder(Pred pred) : pred(pred) {}
-
+	ParallelForEachBuilder(parallel_policy policy, Pred pred) : policy(policy), pred(std::move(pred)) {}
+	
 	template<typename Stream>
 	auto build(Stream stream) {
-		throw_if_endless(stream);
-		while(stream.next())
-			std::invoke(pred, stream.front());
+		if constexpr(is_splittable_v<Stream>) {
+			throw_if_endless(stream);
+			parallel_slices(policy, stream, [this](size_t, auto slice) {
+				ForEachBuilder(std::ref(pred)).build(std::move(slice));
+			});
+		} else {
+			ForEachBuilder(std::move(pred)).build(std::move(stream));
+		}
 	}
 };
 
 template<typename BiPred>
-struct ReduceBuilder {
+struct ParallelReduceBuilder {
+	parallel_policy policy;
 	BiPred biPred;
 	
-	explicit ReduceBuilder(BiPred biPred) : biPred(biPred) {}
+	ParallelReduceBuilder(parallel_policy policy, BiPred biPred) : policy(policy), biPred(std::move(biPred)) {}
 	
 	template<typename Stream>
 	auto build(Stream stream) {
-		throw_if_endless(stream);
-		std::optional<value_t<Stream>> init = stream.next() ? std::optional(stream.front()) : std::nullopt;
-		while(stream.next())
-			init = std::invoke(biPred, init.value(), stream.front());
-		return init;
+		if constexpr(is_splittable_v<Stream>) {
+			throw_if_endless(stream);
+			std::optional<value_t<Stream>> init;
+			for(auto& partial : parallel_partials(policy, stream, [this](auto slice) { 
+				return ReduceBuilder(std::ref(biPred)).build(std::move(slice)); 
+			}))
+				if(*partial)
+					init = init ? std::invoke(biPred, *init, **partial) : **partial;
+			return init;
+		} else {
+			return ReduceBuilder(std::move(biPred)).build(std::move(stream));
+		}
 	}
 };
 
 template<typename Compare>
-struct MinBuilder {
+struct ParallelMinBuilder {
+	parallel_policy policy;
 	Compare compare;
 	
-	explicit MinBuilder(Compare compare) : compare(compare) {}
+	ParallelMinBuilder(parallel_policy policy, Compare compare) : policy(policy), compare(std::move(compare)) {}
 	
 	template<typename Stream>
 	auto build(Stream stream) {
-		throw_if_endless(stream);
-		std::optional<value_t<Stream>> init = stream.next() ? std::optional(stream.front()) : std::nullopt;
-		while(stream.next())
-			init = std::min(stream.front(), init.value(), compare);
-		return init;
+		if constexpr(is_splittable_v<Stream>) {
+			throw_if_endless(stream);
+			std::optional<value_t<Stream>> init;
+			for(auto& partial : parallel_partials(policy, stream, [this](auto slice) { 
+				return MinBuilder(std::ref(compare)).build(std::move(slice)); 
+			}))
+				if(*partial && (!init || !std::invoke(compare, *init, **partial)))
+					init = **partial;
+			return init;
+		} else {
+			return MinBuilder(std::move(compare)).build(std::move(stream));
+		}
 	}
 };
 
 template<typename Compare>
-struct MaxBuilder {
+struct ParallelMaxBuilder {
+	parallel_policy policy;
 	Compare compare;
 	
-	explicit MaxBuilder(Compare compare) : compare(compare) {}
+	ParallelMaxBuilder(parallel_policy policy, Compare compare) : policy(policy), compare(std::move(compare)) {}
 	
 	template<typename Stream>
 	auto build(Stream stream) {
-		throw_if_endless(stream);
-		std::optional<value_t<Stream>> init = stream.next() ? std::optional(stream.front()) : std::nullopt;
-		while(stream.next())
-			init = std::max(stream.front(), init.value(), compare);
-		return init;
+		if constexpr(is_splittable_v<Stream>) {
+			throw_if_endless(stream);
+			std::optional<value_t<Stream>> init;
+			for(auto& partial : parallel_partials(policy, stream, [this](auto slice) { 
+				return MaxBuilder(std::ref(compare)).build(std::move(slice)); 
+			}))
+				if(*partial && (!init || !std::invoke(compare, **partial, *init)))
+					init = **partial;
+			return init;
+		} else {
+			return MaxBuilder(std::move(compare)).build(std::move(stream));
+		}
 	}
 };
 
 template<typename Compare>
-struct MinMaxBuilder {
+struct ParallelMinMaxBuilder {
+	parallel_policy policy;
 	Compare compare;
 	
-	explicit MinMaxBuilder(Compare compare) : compare(compare) {}
+	ParallelMinMaxBuilder(parallel_policy policy, Compare compare) : policy(policy), compare(std::move(compare)) {}
 	
 	template<typename Stream>
-	auto build(Stream stream) const
+	auto build(Stream stream) 
 		-> std::optional<std::pair<value_t<Stream>, value_t<Stream>>> {
-		throw_if_endless(stream);
-		if(stream.next()) {
-			value_t<Stream> min = stream.front(), max = stream.front();
-			while(stream.next()) {
-				min = std::min(stream.front(), min, compare);
-				max = std::max(stream.front(), max, compare);
-			}
-			return std::pair(min, max);
+		if constexpr(is_splittable_v<Stream>) {
+			throw_if_endless(stream);
+			std::optional<std::pair<value_t<Stream>, value_t<Stream>>> init;
+			for(auto& partial : parallel_partials(policy, stream, [this](auto slice) { 
+				return MinMaxBuilder(std::ref(compare)).build(std::move(slice)); 
+			}))
+				if(*partial) {
+					if(!init) {
+						init = **partial;
+						continue;
+					}
+					auto& [min, max] = **partial;
+					if(!std::invoke(compare, init->first, min))
+						init->first = min;
+					if(!std::invoke(compare, max, init->second))
+						init->second = max;
+				}
+			return init;
+		} else {
+			return MinMaxBuilder(std::move(compare)).build(std::move(stream));
 		}
-		return {};
 	}
 };
 
-template<typename Pred>
-struct AllMatchBuilder {
+// all_match, any_match and none_match, every worker stops as soon as an element answers the question
+template<typename Pred, bool expected>
+struct ParallelMatchBuilder {
+	parallel_policy policy;
 	Pred pred;
 	
-	explicit AllMatchBuilder(Pred pred) : pred(pred) {}
+	ParallelMatchBuilder(parallel_policy policy, Pred pred) : policy(policy), pred(std::move(pred)) {}
+	
+	// whether every element e satisfies bool(pred(e)) == expected
+	template<typename Stream>
+	bool build(Stream stream) {
+		throw_if_endless(stream);
+		if constexpr(is_splittable_v<Stream>) {
+			std::atomic<bool> answered(false);
+			parallel_slices(policy, stream, [&](size_t, auto slice) {
+				push_until(slice, [&](auto&& value) {
+					if(answered.load(std::memory_order_relaxed))
+						return false;
+					if(static_cast<bool>(std::invoke(pred, std::forward<decltype(value)>(value))) != expected)
+						return answered.store(true, std::memory_order_relaxed), false;
+					return true;
+				});
+			});
+			return !answered.load();
+		} else {
+			return push_until(stream, [this](auto&& value) {
+				return static_cast<bool>(std::invoke(pred, std::forward<decltype(value)>(value))) == expected;
+			});
+		}
+	}
+};
+
+template<typename Counter>
+struct ParallelCountBuilder {
+	parallel_policy policy;
+	Counter counter;
+	
+	ParallelCountBuilder(parallel_policy policy, Counter counter) : policy(policy), counter(std::move(counter)) {}
+	
+	template<typename Stream>
+	auto build(Stream stream) {
+		if constexpr(is_splittable_v<Stream>) {
+			throw_if_endless(stream);
+			size_t total = 0;
+			for(auto& partial : parallel_partials(policy, stream, [](auto slice) { 
+				return CountBuilder(size_t(0)).build(std::move(slice)); 
+			}))
+				total += *partial;
+			if constexpr(std::is_arithmetic_v<Counter>)
+				counter += total;
+			else
+				while(total--) ++counter;
+			return counter;
+		} else {
+			return CountBuilder(std::move(counter)).build(std::move(stream));
+		}
+	}
+};
+
+// evaluates the pipeline in parallel, then collects the elements in their original order
+template<typename Container, typename Collector>
+struct ParallelCollectBuilder {
+	parallel_policy policy;
+	Container container;
+	Collector collector;
+	
+	ParallelCollectBuilder(parallel_policy policy, Container container, Collector collector) 
+		: policy(policy), container(std::move(container)), collector(std::move(collector)) {}
 	
 	template<typename Stream>
 	auto build(Stream stream) {
 		throw_if_endless(stream);
-		while(stream.next())
-			if(!std::invoke(pred, stream.front()))
-				return false;
-		return true;
+		Container result = container;
+		if constexpr(is_splittable_v<Stream>) {
+			using buffer_type = std::vector<std::remove_cv_t<std::remove_reference_t<value_t<Stream>>>>;
+			for(auto& partial : parallel_partials(policy, stream, [](auto slice) {
+				buffer_type buffer;
+				push_until(slice, [&](auto&& value) { 
+					return buffer.push_back(std::forward<decltype(value)>(value)), true; 
+				});
+				return buffer;
+			}))
+				for(auto& value : *partial)
+					std::invoke(collector, result, std::move(value));
+		} else {
+			push_until(stream, [&](auto&& value) {
+				return std::invoke(collector, result, std::forward<decltype(value)>(value)), true;
+			});
+		}
+		return result;
+	}
+};
+
+// every chunk groups into its own map starting from init, the maps are merged in chunk order by combine(slot, std::move(other))
+template<typename Key, typename Mapped, typename Accumulate, typename Combine>
+struct ParallelGroupingBuilder {
+	parallel_policy policy;
+	GroupingBuilder<Key, Mapped, Accumulate> builder;
+	Combine combine;
+	
+	ParallelGroupingBuilder(parallel_policy policy, Key key, Mapped init, Accumulate accumulate, Combine combine) 
+		: policy(policy), builder(std::move(key), std::move(init), std::move(accumulate)), combine(std::move(combine)) {}
+	
+	template<typename Stream>
+	auto build(Stream stream) {
+		if constexpr(is_splittable_v<Stream>) {
+			throw_if_endless(stream);
+			auto partials = parallel_partials(policy, stream, [this](auto slice) {
+				return GroupingBuilder(std::ref(builder.key), builder.init, std::ref(builder.accumulate)).build(std::move(slice));
+			});
+			auto map = std::move(*partials.front());
+			for(size_t i = 1; i < partials.size(); ++i)
+				for(auto& [key, value] : *partials[i]) {
+					auto [slot, inserted] = map.try_emplace(std::move(key), std::move(value));
+					if(!inserted)
+						std::invoke(combine, *slot, std::move(value));
+				}
+			return map;
+		} else {
+			return builder.build(std::move(stream));
+		}
+	}
+};
+
+template<typename Key>
+struct ParallelGroupByBuilder {
+	parallel_policy policy;
+	Key key;
+	
+	ParallelGroupByBuilder(parallel_policy policy, Key key) : policy(policy), key(std::move(key)) {}
+	
+	template<typename Stream>
+	auto build(Stream stream) {
+		using group_type = std::vector<std::remove_cv_t<std::remove_reference_t<value_t<Stream>>>>;
+		return ParallelGroupingBuilder(policy, std::ref(key), group_type(), AppendingAccumulator{}, ConcatenatingCombiner{})
+			.build(std::move(stream));
 	}
 };
 
 template<typename Pred>
-struct AnyMatchBuilder {
+struct ParallelPartitionByBuilder {
+	parallel_policy policy;
 	Pred pred;
 	
-	explicit AnyMatchBuilder(Pred pred) : pred(pred) {}
-
+	ParallelPartitionByBuilder(parallel_policy policy, Pred pred) : policy(policy), pred(std::move(pred)) {}
+	
 	template<typename Stream>
 	auto build(Stream stream) {
-		throw_if_endless(stream);
-		while(stream.next())
-			if(std::invoke(pred, stream.front()))
-				return true;
+		if constexpr(is_splittable_v<Stream>) {
+			throw_if_endless(stream);
+			auto partials = parallel_partials(policy, stream, [this](auto slice) {
+				return PartitionByBuilder(std::ref(pred)).build(std::move(slice));
+			});
+			auto groups = std::move(*partials.front());
+			for(size_t i = 1; i < partials.size(); ++i) {
+				ConcatenatingCombiner{}(groups.first, std::move(partials[i]->first));
+				ConcatenatingCombiner{}(groups.second, std::move(partials[i]->second));
+			}
+			return groups;
+		} else {
+			return PartitionByBuilder(std::move(pred)).build(std::move(stream));
+		}
+	}
+};
+
+// bounded single-producer single-consumer ring, waiting on a condition variable only when it is full or empty
+// close() wakes both sides: push() fails from then on, pop() fails once the remaining elements are taken
+template<typename T>
+class SpscQueue {
+	std::vector<std::optional<T>> slots;
+	size_t mask;
+	alignas(64) std::atomic<size_t> head; // next slot to pop
+	alignas(64) std::atomic<size_t> tail; // next slot to push
+	alignas(64) std::atomic<bool> closed;
+	std::atomic<size_t> waiting;
+	std::mutex mutex;
+	std::condition_variable changed;
+	
+	template<typename Ready>
+	void wait(Ready ready) {
+		for(int spin = 0; spin != 64; ++spin) {
+			if(ready())
+				return;
+			std::this_thread::yield();
+		}
+		std::unique_lock lock(mutex);
+		waiting.fetch_add(1);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		changed.wait(lock, ready);
+		waiting.fetch_sub(1);
+	}
+	
+	void wake() {
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if(waiting.load(std::memory_order_relaxed)) {
+			{
+				std::lock_guard lock(mutex);
+			}
+			changed.notify_all();
+		}
+	}
+	
+	static size_t round_up(size_t capacity) {
+		size_t size = 1;
+		while(size < capacity)
+			size <<= 1;
+		return size;
+	}
+	
+public:
+	explicit SpscQueue(size_t capacity)
+		: slots(round_up(std::max(capacity, size_t(1)))), mask(slots.size() - 1), 
+		head(0), tail(0), closed(false), waiting(0) {}
+	
+	template<typename U>
+	bool push(U&& value) {
+		size_t t = tail.load(std::memory_order_relaxed);
+		wait([&] { return closed.load(std::memory_order_acquire) || t - head.load(std::memory_order_acquire) != slots.size(); });
+		if(closed.load(std::memory_order_acquire))
+			return false;
+		slots[t & mask].emplace(std::forward<U>(value));
+		tail.store(t + 1, std::memory_order_release);
+		wake();
+		return true;
+	}
+	
+	bool pop(std::optional<T>& out) {
+		size_t h = head.load(std::memory_order_relaxed);
+		wait([&] { return h != tail.load(std::memory_order_acquire) || closed.load(std::memory_order_acquire); });
+		if(h == tail.load(std::memory_order_acquire))
+			return false;
+		out.emplace(*std::move(slots[h & mask]));
+		slots[h & mask].reset();
+		head.store(h + 1, std::memory_order_release);
+		wake();
+		return true;
+	}
+	
+	void close() {
+		closed.store(true, std::memory_order_release);
+		wake();
+	}
+};
+
+// runs the upstream on a producer thread started by the first next(), 
+// handing the elements over a queue of capacity elements
+// an exception thrown by the upstream is rethrown by next() after the elements produced before it
+template<typename Stream>
+struct AsyncBufferStream {
+	using value_type = std::remove_cv_t<std::remove_reference_t<value_t<Stream>>>;
+	
+	struct State {
+		Stream stream;
+		SpscQueue<value_type> queue;
+		size_t limit = -1; // the producer stops after the demand
+#ifndef CPP_STREAM_NO_EXCEPTION
+		std::exception_ptr error;
+#endif
+		State(Stream stream, size_t capacity) : stream(std::move(stream)), queue(capacity) {}
+		
+		void produce() {
+			if(limit)
+				push_until(stream, [this](auto&& value) { 
+					return queue.push(std::forward<decltype(value)>(value)) && --limit != 0; 
+				});
+		}
+	};
+	
+	std::unique_ptr<State> state;
+	std::thread producer;
+	std::optional<value_type> current;
+	bool unbounded;
+	
+	AsyncBufferStream(Stream stream, size_t capacity)
+		: state(std::make_unique<State>(std::move(stream), capacity)), unbounded(state->stream.endless()) {}
+	
+	AsyncBufferStream(AsyncBufferStream&&) = default;
+	AsyncBufferStream& operator=(AsyncBufferStream&&) = delete;
+	
+	~AsyncBufferStream() {
+		if(producer.joinable()) {
+			state->queue.close();
+			producer.join();
+		}
+	}
+	
+	decltype(auto) front() {
+		return *current;
+	}
+	
+	bool next() {
+		if(!producer.joinable())
+			producer = std::thread([state = state.get()] {
+#ifndef CPP_STREAM_NO_EXCEPTION
+				try {
+					state->produce();
+				} catch(...) {
+					state->error = std::current_exception();
+				}
+#else
+				state->produce();
+#endif
+				state->queue.close();
+			});
+		if(state->queue.pop(current))
+			return true;
+#ifndef CPP_STREAM_NO_EXCEPTION
+		if(state->error)
+			std::rethrow_exception(std::exchange(state->error, nullptr));
+#endif
 		return false;
 	}
-};
-
-template<typename Pred>
-struct NoneMatchBuilder {
-	Pred pred;
 	
-	explicit NoneMatchBuilder(Pred pred) : pred(pred) {}
-
-	template<typename Stream>
-	auto build(Stream stream) {
-		throw_if_endless(stream);
-		while(stream.next())
-			if(std::invoke(pred, stream.front()))
-				return false;
-		return true;
+	void demand(size_t n) {
+		state->limit = std::min(state->limit, n);
+		hint_demand(state->stream, n);
+	}
+	
+	bool endless() const {
+		return unbounded;
+	}
+	
+	Buildable;
+};
+
+// maps the elements on workers threads and yields the results in their input order:
+// a distributor thread deals the elements round-robin to the workers, each with a queue in and out
+// pred is shared by the workers and invoked as const
+template<typename Stream, typename Pred>
+struct ParallelMapStream {
+	using input_type = std::remove_cv_t<std::remove_reference_t<value_t<Stream>>>;
+	using value_type = std::decay_t<std::invoke_result_t<Pred const&, input_type&&>>;
+	
+	struct Worker {
+		SpscQueue<input_type> in;
+		SpscQueue<value_type> out;
+		std::thread thread;
+#ifndef CPP_STREAM_NO_EXCEPTION
+		std::exception_ptr error;
+#endif
+		explicit Worker(size_t capacity) : in(capacity), out(capacity) {}
+	};
+	
+	struct State {
+		Stream stream;
+		Pred pred;
+		std::vector<std::unique_ptr<Worker>> workers;
+		std::thread distributor;
+		size_t limit = -1; // the distributor stops after the demand
+#ifndef CPP_STREAM_NO_EXCEPTION
+		std::exception_ptr error;
+#endif
+		State(Stream stream, Pred pred) : stream(std::move(stream)), pred(std::move(pred)) {}
+	};
+	
+	std::unique_ptr<State> state;
+	size_t threads, capacity, index;
+	std::optional<value_type> current;
+	bool unbounded;
+	
+	ParallelMapStream(Stream stream, Pred pred, size_t threads, size_t capacity)
+		: state(std::make_unique<State>(std::move(stream), std::move(pred))), 
+		threads(threads ? threads : std::max(std::thread::hardware_concurrency(), 1u)), 
+		capacity(capacity), index(0), unbounded(state->stream.endless()) {}
+	
+	ParallelMapStream(ParallelMapStream&&) = default;
+	ParallelMapStream& operator=(ParallelMapStream&&) = delete;
+	
+	~ParallelMapStream() {
+		if(!state || state->workers.empty())
+			return;
+		for(auto& worker : state->workers)
+			worker->in.close(), worker->out.close();
+		state->distributor.join();
+		for(auto& worker : state->workers)
+			worker->thread.join();
+	}
+	
+	decltype(auto) front() {
+		return *current;
+	}
+	
+	bool next() {
+		if(state->workers.empty())
+			start();
+		Worker& worker = *state->workers[index];
+		index = (index + 1) % state->workers.size();
+		if(worker.out.pop(current))
+			return true;
+#ifndef CPP_STREAM_NO_EXCEPTION
+		if(worker.error)
+			std::rethrow_exception(std::exchange(worker.error, nullptr));
+		if(state->error)
+			std::rethrow_exception(std::exchange(state->error, nullptr));
+#endif
+		return false;
+	}
+	
+	void demand(size_t n) {
+		state->limit = std::min(state->limit, n);
+		hint_demand(state->stream, n);
+	}
+	
+	bool endless() const {
+		return unbounded;
 	}
-};
-
-template<typename Counter>
-struct CountBuilder {
-	Counter counter;
 	
-	explicit CountBuilder(Counter counter) : counter(counter) {}
+	Buildable;
 	
-	template<typename Stream>
-	auto build(Stream stream) {
-		throw_if_endless(stream);
-		while(stream.next()) ++counter;
-		return counter;
+private:
+	void start() {
+		State* s = state.get();
+		for(size_t i = 0; i != threads; ++i)
+			s->workers.push_back(std::make_unique<Worker>(capacity));
+		for(auto& worker : s->workers)
+			worker->thread = std::thread([s, worker = worker.get()] {
+				std::optional<input_type> input;
+#ifndef CPP_STREAM_NO_EXCEPTION
+				try {
+					while(worker->in.pop(input) && worker->out.push(std::invoke(std::as_const(s->pred), *std::move(input))));
+				} catch(...) {
+					worker->error = std::current_exception();
+					worker->in.close();
+				}
+#else
+				while(worker->in.pop(input) && worker->out.push(std::invoke(std::as_const(s->pred), *std::move(input))));
+#endif
+				worker->out.close();
+			});
+		s->distributor = std::thread([s] {
+			size_t next = 0;
+			auto deal = [s, &next](auto&& value) {
+				Worker& worker = *s->workers[next];
+				next = (next + 1) % s->workers.size();
+				return worker.in.push(std::forward<decltype(value)>(value)) && --s->limit != 0;
+			};
+#ifndef CPP_STREAM_NO_EXCEPTION
+			try {
+				if(s->limit)
+					push_until(s->stream, deal);
+			} catch(...) {
+				s->error = std::current_exception();
+			}
+#else
+			if(s->limit)
+				push_until(s->stream, deal);
+#endif
+			for(auto& worker : s->workers)
+				worker->in.close();
+		});
 	}
 };
+#endif
 
 template<typename First>
-auto from_endless_iterator(First first) {
+constexpr auto from_endless_iterator(First first) {
 	return EndlessIteratorStream(first);
 }
 
 template<typename First, typename Last>
-auto from_iterator(First first, Last last) {
+constexpr auto from_iterator(First first, Last last) {
 	return IteratorStream(first, last, false);
 }
 
 template<typename Container>  
-auto from(Container const& container) {
+constexpr auto from(Container const& container) {
 	return from_iterator(std::begin(container), std::end(container));
 }
 
+template<typename Range, typename = void>
+struct is_const_iterable : std::false_type {};
+
+template<typename Range>
+struct is_const_iterable<Range, std::void_t<decltype(std::begin(std::declval<Range const&>()))>> : std::true_type {};
+
+// ranges which can be iterated only when not const, such as std::views::filter
+template<typename Range, typename = std::enable_if_t<!is_const_iterable<Range>::value>>
+constexpr auto from(Range& range) {
+	return from_iterator(std::begin(range), std::end(range));
+}
+
 template<typename First, typename Last>
-auto from_unchecked_iterator(First first, Last last) {
+constexpr auto from_unchecked_iterator(First first, Last last) {
 	return IteratorStream(first, last, true);
 }
 
 template<typename Container>  
-auto from_unchecked(Container const& container) {
-	return from_iterator(std::begin(container), std::end(container));
+constexpr auto from_unchecked(Container const& container) {
+	return from_unchecked_iterator(std::begin(container), std::end(container));
+}
+
+#ifndef CPP_STREAM_NO_COROUTINE
+template<typename T>
+auto from_generator(Generator<T> generator) {
+	return GeneratorStream(std::move(generator), false);
+}
+
+template<typename T>
+auto from_endless_generator(Generator<T> generator) {
+	return GeneratorStream(std::move(generator), true);
+}
+#endif
+
+inline auto from_file_lines(std::string const& path) {
+	return DelimitedStream(std::make_shared<MappedFile const>(path), '\n', true);
+}
+
+inline auto from_file_records(std::string const& path, char delimiter) {
+	return DelimitedStream(std::make_shared<MappedFile const>(path), delimiter, false);
+}
+
+inline auto from_delimited(std::string_view text, char delimiter) {
+	return DelimitedStream(text, delimiter, false);
+}
+
+template<typename T>
+auto from_mmap(std::string const& path) {
+	return MappedStream<T>(std::make_shared<MappedFile const>(path));
+}
+
+inline auto from_lines(std::istream& in, char delimiter = '\n') {
+	return LineStream(in, delimiter);
+}
+
+// reads the elements written by serialize_to
+template<typename T>
+auto deserialize_from(std::FILE* file) {
+	return DeserializeStream<T, std::FILE*>(file);
+}
+
+template<typename T>
+auto deserialize_from(std::istream& in) {
+	return DeserializeStream<T, std::istream*>(&in);
 }
 
 
 template<typename IntType>
-auto iota(IntType first, IntType step = 1) {
+constexpr auto iota(IntType first, IntType step = 1) {
 	return IntegerStream<IntType>(first, step);
 }
 
 template<typename Getter>
-auto generate(Getter getter) {
-	return GenerateStream(getter);
+constexpr auto generate(Getter getter) {
+	return GenerateStream(std::move(getter));
 }
 
 template<typename Pred>  
-auto filter(Pred pred) { return builder_of<FilterStream>(pred); }
+constexpr auto filter(Pred pred) { return builder_of<FilterStream>(std::move(pred)); }
 
 template<typename Pred>  
-auto map(Pred pred) { return builder_of<MapStream>(pred); }
+constexpr auto map(Pred pred) { return builder_of<MapStream>(std::move(pred)); }
 
-auto take(size_t count) { return make_builder([count](auto stream){ return TakeStream(stream, count);}); };
+constexpr auto take(size_t count) { return make_builder([count](auto stream){ hint_demand(stream, count); return StageFusion<TakeStream>::fuse(std::move(stream), count);}); };
 
-auto skip(size_t count) { return make_builder([count](auto stream){ return SkipStream(stream, count);}); };
+constexpr auto skip(size_t count) { return make_builder([count](auto stream){ return StageFusion<SkipStream>::fuse(std::move(stream), count);}); };
 
 template<typename Pred>
-auto take_while(Pred pred) { return builder_of<TakeWhileStream>(pred); };
+constexpr auto take_while(Pred pred) { return builder_of<TakeWhileStream>(std::move(pred)); };
 
 template<typename Pred>
-auto skip_while(Pred pred) { return builder_of<SkipWhileStream>(pred); };
+constexpr auto skip_while(Pred pred) { return builder_of<SkipWhileStream>(std::move(pred)); };
+
+#ifndef CPP_STREAM_NO_PROFILE
+// reports the statistics of the profiled stages up to here to out once the stream is destroyed
+inline auto profile(std::string name, std::ostream& out = std::clog) {
+	return make_builder([name = std::move(name), out = &out](auto stream) {
+		return ProfileStream(std::move(stream), name, out);
+	});
+}
+#endif
+
+// the buffering stages after it allocate from arena, which must outlive them
+inline auto with_arena(std::pmr::memory_resource* arena) {
+	return make_builder([arena](auto stream) { return ArenaStream(std::move(stream), arena); });
+}
+
+inline auto chunks(size_t count) { return make_builder([count](auto stream){ return ChunkStream(std::move(stream), count);}); };
+inline auto sliding(size_t count, size_t step = 1) { return make_builder([count, step](auto stream){ return SlidingStream(std::move(stream), count, step);}); };
+inline auto window(size_t count) { return sliding(count, count); };
+
+template<typename Op>
+auto sliding_reduce(size_t count, Op op) {
+	return make_builder([count, op = std::move(op)](auto stream) mutable {
+		return SlidingReduceStream(std::move(stream), count, std::move(op));
+	});
+}
+
+// inverse(op(y, x), x) == y, e.g. std::minus<>{} for std::plus<>{}
+template<typename Op, typename Inverse>
+auto sliding_reduce(size_t count, Op op, Inverse inverse) {
+	return make_builder([count, op = std::move(op), inverse = std::move(inverse)](auto stream) mutable {
+		return InvertibleSlidingStream(std::move(stream), count, std::move(op), std::move(inverse));
+	});
+}
 
 template<typename Init, typename Pred>
-auto iterate(Init init, Pred pred) {
+constexpr auto iterate(Init init, Pred pred) {
 	return GenerateStream([=, first = true] () mutable {return first ? first = false, init : init = pred(init);});
 }
 
 template<typename Init, typename Pred0, typename Pred>
-auto iterate(Init init, Pred0 pred0, Pred pred) {
+constexpr auto iterate(Init init, Pred0 pred0, Pred pred) {
 	return iterate(init, pred) >> take_while(pred0);
 }
 
 template<typename IntType>
-auto int_range(IntType last) {
+constexpr auto int_range(IntType last) {
 	return iota(IntType(0), IntType(1)) >> take(last);
 }
 template<typename IntType>
-auto int_range(IntType first, IntType last) {
+constexpr auto int_range(IntType first, IntType last) {
 	return iota(first, IntType(1)) >> take(last - first);
 }
 
 template<typename IntType>
-auto int_range(IntType first, IntType last, IntType step) {
-	return iota(first, step) >> take((last - first + IntType(1)) / step);
+constexpr auto int_range(IntType first, IntType last, IntType step) {
+	// the count of steps rounded up, none if step leads away from last
+	// integers are subtracted as unsigned, so neither the distance nor -step overflows
+	size_t count = 0;
+	if constexpr(std::is_integral_v<IntType>) {
+		using Unsigned = std::make_unsigned_t<IntType>;
+		if(first < last && IntType(0) < step)
+			count = size_t((Unsigned(Unsigned(last) - Unsigned(first)) - 1u) / Unsigned(step) + 1u);
+		else if(last < first && step < IntType(0))
+			count = size_t((Unsigned(Unsigned(first) - Unsigned(last)) - 1u) / Unsigned(Unsigned(0) - Unsigned(step)) + 1u);
+	} else {
+		if(first < last && IntType(0) < step)
+			count = size_t((last - first + step - IntType(1)) / step);
+		else if(last < first && step < IntType(0))
+			count = size_t((first - last - step - IntType(1)) / -step);
+	}
+	return iota(first, step) >> take(count);
 }
 
 template<typename T>
-auto empty_stream() {
+constexpr auto empty_stream() {
 	return EmptyStream<T>();
 }
 
 template<typename T>
-auto endless_singleton(std::nullopt_t) {
+constexpr auto endless_empty_stream() {
+	return MakeEndlessStream(empty_stream<T>());
+}
+
+template<typename T>
+constexpr auto endless_singleton(std::nullopt_t) {
 	return endless_empty_stream<T>();
 }
 
 template<typename T>
-auto endless_singleton(std::optional<T> opt) {
+constexpr auto endless_singleton(std::optional<T> opt) {
 	return generate([=]{ return opt; }) >> filter([](auto opt){ return opt.has_value(); }) >> map([](auto opt){ return opt.value(); });
 }
 
 template<typename T>
-auto singleton(std::nullopt_t) {
+constexpr auto singleton(std::nullopt_t) {
 	return empty_stream<T>();
 }
 
 template<typename T>
-auto singleton(std::optional<T> opt) {
+constexpr auto singleton(std::optional<T> opt) {
 	return generate([=]{ return *opt; }) >> take(opt.has_value());
 }
 
-auto sort() {
+inline auto sort() {
 	return builder_of<SortStream>(std::less<>{});
 }
 
 template<typename Compare>
 auto sort(Compare compare) {
-	return builder_of<SortStream>(compare);
+	return builder_of<SortStream>(std::move(compare));
+}
+
+template<typename Compare>
+auto unstable_sort(Compare compare) {
+	return make_builder([compare = std::move(compare)](auto stream) mutable { 
+		return SortStream(std::move(stream), std::move(compare), false); 
+	});
+}
+
+inline auto unstable_sort() {
+	return unstable_sort(std::less<>{});
+}
+
+// stable sort through temporary files, using about memory_budget bytes for the elements
+// the elements are spilled through Serializer
+template<typename Compare>
+auto external_sort(Compare compare, size_t memory_budget) {
+	return make_builder([compare = std::move(compare), memory_budget](auto stream) mutable {
+		return ExternalSortStream(std::move(stream), std::move(compare), memory_budget);
+	});
+}
+
+inline auto external_sort(size_t memory_budget) {
+	return external_sort(std::less<>{}, memory_budget);
+}
+
+// the first count elements in the order of compare, the count greatest ones by default
+template<typename Compare>
+auto top_k(size_t count, Compare compare) {
+	return chain_builder(sort(std::move(compare)), take(count));
+}
+
+inline auto top_k(size_t count) {
+	return top_k(count, std::greater<>{});
+}
+
+// walks the source backwards if it can, buffers the elements otherwise
+inline auto reverse() { 
+	return make_builder([](auto stream) {
+		throw_if_endless(stream);
+		if constexpr(is_reversible_v<decltype(stream)>)
+			return Reverser<decltype(stream)>::reverse(std::move(stream));
+		else
+			return ReverseStream(std::move(stream));
+	}); 
+}
+
+// hash based if std::hash supports the elements, std::set otherwise
+inline auto distinct() { 
+	return make_builder([](auto stream) {
+		using Stream = decltype(stream);
+		using Element = std::remove_cv_t<std::remove_reference_t<value_t<Stream>>>;
+		if constexpr(is_hashable_v<Element>) {
+			using Set = FlatHashSet<buffered_t<Stream>, Unbuffered<Stream, std::hash<Element>>, Unbuffered<Stream, std::equal_to<>>>;
+			Set set({}, {}, memory_resource_of(stream));
+			return DistinctStream<Stream, Set>(std::move(stream), std::move(set));
+		} else {
+			using Set = std::pmr::set<buffered_t<Stream>, Unbuffered<Stream, std::less<>>>;
+			Set set(memory_resource_of(stream));
+			return DistinctStream<Stream, Set>(std::move(stream), std::move(set));
+		}
+	}); 
+}
+
+template<typename Hash, typename Equal = std::equal_to<>>
+auto distinct(Hash hash, Equal equal = {}) { 
+	return make_builder([hash = std::move(hash), equal = std::move(equal)](auto stream) {
+		using Stream = decltype(stream);
+		using Set = FlatHashSet<buffered_t<Stream>, Unbuffered<Stream, Hash>, Unbuffered<Stream, Equal>>;
+		Set set({hash}, {equal}, memory_resource_of(stream));
+		return DistinctStream<Stream, Set>(std::move(stream), std::move(set));
+	}); 
+}
+
+// only the last capacity distinct elements are remembered, an element seen before them passes again
+template<typename Hash, typename Equal = std::equal_to<>>
+auto distinct_recent(size_t capacity, Hash hash, Equal equal = {}) { 
+	return make_builder([capacity, hash = std::move(hash), equal = std::move(equal)](auto stream) {
+		using Stream = decltype(stream);
+		using Set = RecentSet<buffered_t<Stream>, Unbuffered<Stream, Hash>, Unbuffered<Stream, Equal>>;
+		Set set(capacity, {hash}, {equal}, memory_resource_of(stream));
+		return DistinctStream<Stream, Set>(std::move(stream), std::move(set));
+	}); 
 }
 
-auto reverse() { return make_builder([](auto stream){ return throw_if_endless(stream), ReverseStream(stream); }); }
+inline auto distinct_recent(size_t capacity) { 
+	return make_builder([capacity](auto stream) {
+		using Stream = decltype(stream);
+		using Element = std::remove_cv_t<std::remove_reference_t<value_t<Stream>>>;
+		return distinct_recent(capacity, std::hash<Element>{}).build(std::move(stream));
+	}); 
+}
 
-auto distinct() { return builder_of<DistinctStream>(); }
+template<typename Equal = std::equal_to<>>
+auto distinct_adjacent(Equal equal = {}) { return builder_of<DistinctAdjacentStream>(std::move(equal)); }
 
 template<typename Peeker>
-auto peek(Peeker peeker) { return builder_of<PeekStream>(peeker); }
+constexpr auto peek(Peeker peeker) { return builder_of<PeekStream>(std::move(peeker)); }
 
-auto endless_flat() { return builder_of<EndlessFlatStream>(); }
+inline auto endless_flat() { return builder_of<EndlessFlatStream>(); }
 
-auto flat() { return builder_of<FlatStream>(); }
+inline auto flat() { return builder_of<FlatStream>(); }
 
-auto make_endless() { return builder_of<MakeEndlessStream>(); }
+constexpr auto make_endless() { return builder_of<MakeEndlessStream>(); }
 
-auto tail_repeat() { return builder_of<TailRepeatStream>(); }
+inline auto tail_repeat() { return builder_of<TailRepeatStream>(); }
 
-auto loop() { return builder_of<LoopStream>(); }
+inline auto loop() { return builder_of<LoopStream>(); }
 
 template<typename ...Streams>
 auto join_streams(Streams... streams) {
-	return JoinStreams<std::remove_reference_t<Streams>...>(streams...);
+	return JoinStreams<std::remove_reference_t<Streams>...>(std::move(streams)...);
 } 
 template<typename Pred, typename ...Streams>
 auto combine_streams(Pred pred, Streams... streams) {
-	return CombineStreams<std::remove_reference_t<Streams>...>(pred, streams...);
+	return CombineStreams<Pred, std::remove_reference_t<Streams>...>(std::move(pred), std::move(streams)...);
 } 
 
-IterableBuilder iterable() { return {}; }
+// the streams must be sorted by compare
+template<typename Compare, typename StreamA, typename ...Streams>
+auto merge_streams(Compare compare, StreamA streamA, Streams... streams) {
+	return MergeStreams<Compare, StreamA, Streams...>(std::move(compare), std::move(streamA), std::move(streams)...);
+}
+
+template<typename Compare, typename Stream>
+auto merge_streams(Compare compare, std::vector<Stream> streams) {
+	return MergeStreamVector<Compare, Stream>(std::move(compare), std::move(streams));
+}
+
+// recombines shards in order, merge_streams recombines sorted ones instead
+template<typename Stream>
+auto gather(std::vector<Stream> shards) {
+	return GatherStream<Stream>(std::move(shards));
+}
+
+template<typename StreamA, typename StreamB, typename Compare = std::less<>>
+auto set_union(StreamA streamA, StreamB streamB, Compare compare = {}) {
+	return SetOperationStream<keep_only_a | keep_only_b | keep_both, StreamA, StreamB, Compare>(
+		std::move(streamA), std::move(streamB), std::move(compare));
+}
+
+template<typename StreamA, typename StreamB, typename Compare = std::less<>>
+auto set_intersection(StreamA streamA, StreamB streamB, Compare compare = {}) {
+	return SetOperationStream<keep_both, StreamA, StreamB, Compare>(std::move(streamA), std::move(streamB), std::move(compare));
+}
+
+template<typename StreamA, typename StreamB, typename Compare = std::less<>>
+auto set_difference(StreamA streamA, StreamB streamB, Compare compare = {}) {
+	return SetOperationStream<keep_only_a, StreamA, StreamB, Compare>(std::move(streamA), std::move(streamB), std::move(compare));
+}
+
+template<typename StreamA, typename StreamB, typename Compare = std::less<>>
+auto set_symmetric_difference(StreamA streamA, StreamB streamB, Compare compare = {}) {
+	return SetOperationStream<keep_only_a | keep_only_b, StreamA, StreamB, Compare>(
+		std::move(streamA), std::move(streamB), std::move(compare));
+}
+
+inline IterableBuilder iterable() { return {}; }
 
 template<typename Pred>
-auto for_each(Pred pred) { return ForEachBuilder(pred); }
+constexpr auto for_each(Pred pred) { return ForEachBuilder(std::move(pred)); }
 
-auto first() { return make_builder([](auto stream){ return stream.next() ? std::optional(stream.front()) : std::nullopt; }); }
+constexpr auto first() { return make_builder([](auto stream){ hint_demand(stream, 1); return stream.next() ? std::optional(stream.front()) : std::nullopt; }); }
 
 template<typename BiPred>
-auto reduce(BiPred biPred) { return ReduceBuilder(biPred); }
+constexpr auto reduce(BiPred biPred) { return ReduceBuilder(std::move(biPred)); }
 
-auto min() { return MinBuilder(std::less<>{}); }
+constexpr auto min() { return MinBuilder(std::less<>{}); }
 
-auto max() { return MaxBuilder(std::less<>{}); }
+constexpr auto max() { return MaxBuilder(std::less<>{}); }
 
-auto minmax() { return MinMaxBuilder(std::less<>{}); }
+constexpr auto minmax() { return MinMaxBuilder(std::less<>{}); }
 
 template<typename Compare>
-auto min(Compare compare) { return MinBuilder(compare); }
+constexpr auto min(Compare compare) { return MinBuilder(std::move(compare)); }
 
 template<typename Compare>
-auto max(Compare compare) { return MaxBuilder(compare); }
+constexpr auto max(Compare compare) { return MaxBuilder(std::move(compare)); }
 
 template<typename Compare>
-auto minmax(Compare compare) { return MinMaxBuilder(compare); }
+constexpr auto minmax(Compare compare) { return MinMaxBuilder(std::move(compare)); }
 
 template<typename Pred>
-auto all_match(Pred pred) { return FindAllBuilder(pred); }
+constexpr auto all_match(Pred pred) { return AllMatchBuilder(std::move(pred)); }
 
 template<typename Pred>
-auto any_match(Pred pred) { return FindAnyBuilder(pred); }
+constexpr auto any_match(Pred pred) { return AnyMatchBuilder(std::move(pred)); }
 
 template<typename Pred>
-auto none_match(Pred pred) { return FindNoneBuilder(pred); }
+constexpr auto none_match(Pred pred) { return NoneMatchBuilder(std::move(pred)); }
 
 template<typename Counter>
-auto count(Counter counter) { return CountBuilder(counter); }
+constexpr auto count(Counter counter) { return CountBuilder(std::move(counter)); }
 
 template<typename Container, typename Collector>
 auto collect(Container container, Collector collector) {
-	return make_builder([=](auto stream) mutable {
-		stream >> for_each(std::bind(collector, std::ref(container), std::placeholders::_1));
-		return container;
+	// collects into a copy of the initial container, which is returned without another copy
+	return make_builder([container = std::move(container), collector = std::move(collector)](auto stream) mutable {
+		throw_if_endless(stream);
+		Container result = container;
+		if constexpr(is_sized_v<decltype(stream)> && has_reserve<Container>::value)
+			result.reserve(result.size() + stream.size());
+		drain(stream, [&](auto&& value) {
+			std::invoke(collector, result, std::forward<decltype(value)>(value));
+		});
+		return result;
+	});
+}
+
+inline auto to_vector() {
+	return make_builder([](auto stream) {
+		std::vector<std::remove_cv_t<std::remove_reference_t<value_t<decltype(stream)>>>> result;
+		IntoBuilder(result).build(std::move(stream));
+		return result;
+	});
+}
+
+template<typename Key, typename Value>
+auto to_unordered_map(Key key, Value val) { return ToUnorderedMapBuilder(std::move(key), std::move(val)); }
+
+// chars are appended one by one, other elements through operator+=
+inline auto to_string() {
+	return make_builder([](auto stream) {
+		std::string result;
+		if constexpr(std::is_same_v<std::remove_cv_t<std::remove_reference_t<value_t<decltype(stream)>>>, char>) {
+			IntoBuilder(result).build(std::move(stream));
+		} else {
+			throw_if_endless(stream);
+			push_until(stream, [&](auto&& value) { return result += std::forward<decltype(value)>(value), true; });
+		}
+		return result;
+	});
+}
+
+// returns container itself, which is not cleared before
+template<typename Container>
+auto into(Container& container) { return IntoBuilder(container); }
+
+// writes the elements in frames and returns their count, the channel is not flushed
+inline auto serialize_to(std::FILE* file) { return SerializeBuilder<std::FILE*>{file}; }
+
+inline auto serialize_to(std::ostream& out) { return SerializeBuilder<std::ostream*>{&out}; }
+
+// the first N elements, which are fewer only by throwing stream_exception, usable in constant expressions
+template<size_t N>
+constexpr auto to_array() {
+	return make_builder([](auto stream) {
+		hint_demand(stream, N);
+		std::array<std::remove_cv_t<std::remove_reference_t<value_t<decltype(stream)>>>, N> result{};
+		size_t i = 0;
+		if(N != 0)
+			push_until(stream, [&](auto&& value) { return result[i++] = std::forward<decltype(value)>(value), i != N; });
+		if(i != N)
+#ifndef CPP_STREAM_NO_EXCEPTION
+			throw stream_exception();
+#else
+			std::abort();
+#endif
+		return result;
+	});
+}
+
+template<typename Key>
+auto group_by(Key key) { return GroupByBuilder(std::move(key)); }
+
+template<typename Key>
+auto counting_by(Key key) { return GroupingBuilder(std::move(key), size_t(0), CountingAccumulator{}); }
+
+template<typename Key, typename Init, typename Op>
+auto aggregate_by(Key key, Init init, Op op) { return GroupingBuilder(std::move(key), std::move(init), FoldingAccumulator<Op>{std::move(op)}); }
+
+template<typename Pred>
+auto partition_by(Pred pred) { return PartitionByBuilder(std::move(pred)); }
+
+// count shards of consecutive elements, only for sized random access sources
+inline auto split(size_t count) { return SplitBuilder{count}; }
+
+// count shards by hasher(element) % count in a single pass, the order within a shard is kept
+template<typename Hasher>
+auto partition(size_t count, Hasher hasher) { return PartitionBuilder(count, std::move(hasher)); }
+
+inline auto partition(size_t count) {
+	return make_builder([count](auto stream) {
+		return PartitionBuilder(count, std::hash<std::remove_cv_t<std::remove_reference_t<value_t<decltype(stream)>>>>{}).build(std::move(stream));
+	});
+}
+
+#ifndef CPP_STREAM_NO_PARALLEL
+inline auto sort(parallel_policy policy) {
+	return make_builder([policy](auto stream) { return ParallelSortStream(std::move(stream), std::less<>{}, policy); });
+}
+
+template<typename Compare>
+auto sort(parallel_policy policy, Compare compare) {
+	return make_builder([policy, compare = std::move(compare)](auto stream) mutable { 
+		return ParallelSortStream(std::move(stream), std::move(compare), policy); 
+	});
+}
+
+template<typename Compare>
+auto unstable_sort(parallel_policy policy, Compare compare) {
+	return make_builder([policy, compare = std::move(compare)](auto stream) mutable { 
+		return ParallelSortStream(std::move(stream), std::move(compare), policy, false); 
 	});
 }
 
-auto element_at(size_t pos) {
-	return make_builder([pos](auto stream){ return stream >> skip(pos) >> first(); });
+inline auto unstable_sort(parallel_policy policy) {
+	return unstable_sort(policy, std::less<>{});
+}
+
+template<typename Pred>
+auto for_each(parallel_policy policy, Pred pred) { return ParallelForEachBuilder(policy, std::move(pred)); }
+
+template<typename BiPred>
+auto reduce(parallel_policy policy, BiPred biPred) { return ParallelReduceBuilder(policy, std::move(biPred)); }
+
+inline auto min(parallel_policy policy) { return ParallelMinBuilder(policy, std::less<>{}); }
+
+inline auto max(parallel_policy policy) { return ParallelMaxBuilder(policy, std::less<>{}); }
+
+inline auto minmax(parallel_policy policy) { return ParallelMinMaxBuilder(policy, std::less<>{}); }
+
+template<typename Compare>
+auto min(parallel_policy policy, Compare compare) { return ParallelMinBuilder(policy, std::move(compare)); }
+
+template<typename Compare>
+auto max(parallel_policy policy, Compare compare) { return ParallelMaxBuilder(policy, std::move(compare)); }
+
+template<typename Compare>
+auto minmax(parallel_policy policy, Compare compare) { return ParallelMinMaxBuilder(policy, std::move(compare)); }
+
+template<typename Pred>
+auto all_match(parallel_policy policy, Pred pred) { return ParallelMatchBuilder<Pred, true>(policy, std::move(pred)); }
+
+template<typename Pred>
+auto any_match(parallel_policy policy, Pred pred) { 
+	return make_builder([builder = ParallelMatchBuilder<Pred, false>(policy, std::move(pred))](auto stream) mutable { 
+		return !builder.build(std::move(stream)); 
+	}); 
+}
+
+template<typename Pred>
+auto none_match(parallel_policy policy, Pred pred) { return ParallelMatchBuilder<Pred, false>(policy, std::move(pred)); }
+
+template<typename Counter>
+auto count(parallel_policy policy, Counter counter) { return ParallelCountBuilder(policy, std::move(counter)); }
+
+template<typename Container, typename Collector>
+auto collect(parallel_policy policy, Container container, Collector collector) { 
+	return ParallelCollectBuilder(policy, std::move(container), std::move(collector)); 
+}
+
+template<typename Key>
+auto group_by(parallel_policy policy, Key key) { return ParallelGroupByBuilder(policy, std::move(key)); }
+
+template<typename Key>
+auto counting_by(parallel_policy policy, Key key) { 
+	return ParallelGroupingBuilder(policy, std::move(key), size_t(0), CountingAccumulator{}, SummingCombiner{}); 
+}
+
+// partial results are merged by slot = combine(std::move(slot), std::move(other))
+// every chunk starts its keys from init, so init must be an identity of combine to agree with the sequential result
+template<typename Key, typename Init, typename Op, typename Combine>
+auto aggregate_by(parallel_policy policy, Key key, Init init, Op op, Combine combine) { 
+	return ParallelGroupingBuilder(policy, std::move(key), std::move(init), 
+		FoldingAccumulator<Op>{std::move(op)}, FoldingAccumulator<Combine>{std::move(combine)}); 
+}
+
+template<typename Key, typename Init, typename Op>
+auto aggregate_by(parallel_policy policy, Key key, Init init, Op op) { 
+	return aggregate_by(policy, std::move(key), std::move(init), op, op); 
+}
+
+template<typename Pred>
+auto partition_by(parallel_policy policy, Pred pred) { return ParallelPartitionByBuilder(policy, std::move(pred)); }
+
+inline auto async_buffer(size_t capacity = 1024) { 
+	return make_builder([capacity](auto stream){ return AsyncBufferStream(std::move(stream), capacity); }); 
+}
+
+// threads = 0 uses std::thread::hardware_concurrency() workers
+template<typename Pred>
+auto parallel_map(Pred pred, size_t threads = 0, size_t capacity = 256) { 
+	return make_builder([pred = std::move(pred), threads, capacity](auto stream) mutable { 
+		return ParallelMapStream(std::move(stream), std::move(pred), threads, capacity); 
+	}); 
+}
+#endif
+
+constexpr auto element_at(size_t pos) {
+	return make_builder([pos](auto stream){ return std::move(stream) >> skip(pos) >> first(); });
 }
 
 template<typename Pred>
 auto endless_flat_map(Pred pred) {
-	return make_builder([pred](auto stream){ return map(pred).build(std::move(stream)) >> endless_flat(); });
+	return chain_builder(map(std::move(pred)), endless_flat());
 }
 
 template<typename Pred>
 auto flat_map(Pred pred) {
-	return make_builder([pred](auto stream){ return map(pred).build(std::move(stream)) >> flat(); });
+	return chain_builder(map(std::move(pred)), flat());
 }
 
 namespace type_erasure {
 
+// streams whose holder fits here are stored inside AnyStream without allocation
+constexpr size_t inline_size = 8 * sizeof(void*);
+
+// a non-owning reference to a sink, called through a function pointer instead of a virtual function
 template<typename T>
+class SinkRef {
+	void* sink;
+	bool (*call)(void*, T&&);
+	
+public:
+	template<typename Sink>
+	SinkRef(Sink& sink) 
+		: sink(std::addressof(sink)), call([](void* sink, T&& value) -> bool {
+			return std::invoke(*static_cast<Sink*>(sink), std::move(value));
+		}) {}
+	
+	bool operator()(T&& value) const {
+		return call(sink, std::move(value));
+	}
+};
+
+template<typename T, typename Allocator>
 struct StreamHolderBase {
 	using value_type = T;
 	virtual ~StreamHolderBase() {}
-#ifndef YAO_STREAM_NO_TYPEINFO
+#ifndef CPP_STREAM_NO_TYPEINFO
 	virtual const std::type_info& type() const = 0; 
 #endif
-	virtual StreamHolderBase* clone() const = 0;
+	// constructs a copy or moves the stream into buffer if it fits, otherwise into memory from alloc
+	virtual StreamHolderBase* clone(void* buffer, Allocator const& alloc) const = 0;
+	virtual StreamHolderBase* move_to(void* buffer, Allocator const& alloc) = 0;
+	virtual void destroy(Allocator const& alloc) = 0;
 	virtual value_type front() = 0;
 	virtual bool next() = 0;
+	virtual size_t next_n(value_type* out, size_t n) = 0;
+	virtual bool for_each_until(SinkRef<value_type> sink) = 0;
 	virtual bool endless() const = 0;
 };
-template<typename Stream>
-struct StreamHolder : StreamHolderBase<value_t<Stream>> {
-	using base_type = StreamHolderBase<value_t<Stream>>;
+
+template<typename Stream, typename Allocator>
+struct StreamHolder : StreamHolderBase<value_t<Stream>, Allocator> {
+	using base_type = StreamHolderBase<value_t<Stream>, Allocator>;
+	using holder_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<StreamHolder>;
+	using allocator_traits = std::allocator_traits<holder_allocator>;
+	
 	Stream stream;
 	
-	StreamHolder(Stream stream) : stream(stream) {}
+	StreamHolder(Stream stream) : stream(std::move(stream)) {}
+	
+	static constexpr bool local() {
+		return sizeof(StreamHolder) <= inline_size && alignof(StreamHolder) <= alignof(std::max_align_t) 
+			&& std::is_nothrow_move_constructible_v<Stream>;
+	}
+	
+	template<typename S>
+	static base_type* create(S&& stream, void* buffer, Allocator const& alloc) {
+		if constexpr(local()) {
+			return ::new(buffer) StreamHolder(std::forward<S>(stream));
+		} else {
+			holder_allocator a(alloc);
+			StreamHolder* holder = allocator_traits::allocate(a, 1);
+#ifndef CPP_STREAM_NO_EXCEPTION
+			try {
+				allocator_traits::construct(a, holder, std::forward<S>(stream));
+			} catch(...) {
+				allocator_traits::deallocate(a, holder, 1);
+				throw;
+			}
+#else
+			allocator_traits::construct(a, holder, std::forward<S>(stream));
+#endif
+			return holder;
+		}
+	}
 
-#ifndef YAO_STREAM_NO_TYPEINFO
+#ifndef CPP_STREAM_NO_TYPEINFO
 	virtual const std::type_info& type() const override {
 		return typeid(stream);
 	}
 #endif
 
-	virtual base_type* clone() const override {
-		return new StreamHolder(stream);
+	virtual base_type* clone(void* buffer, Allocator const& alloc) const override {
+		return create(stream, buffer, alloc);
+	}
+	
+	virtual base_type* move_to(void* buffer, Allocator const& alloc) override {
+		return create(std::move(stream), buffer, alloc);
+	}
+	
+	virtual void destroy(Allocator const& alloc) override {
+		if constexpr(local()) {
+			this->~StreamHolder();
+		} else {
+			holder_allocator a(alloc);
+			allocator_traits::destroy(a, this);
+			allocator_traits::deallocate(a, this, 1);
+		}
 	}
 	
 	virtual typename base_type::value_type front() override {
@@ -1142,48 +6378,100 @@ struct StreamHolder : StreamHolderBase<value_t<Stream>> {
 		return stream.next();
 	}
 	
+	virtual size_t next_n(typename base_type::value_type* out, size_t n) override {
+		size_t i = 0;
+		if(n)
+			push_until(stream, [&](auto&& value) {
+				return out[i++] = std::forward<decltype(value)>(value), i != n;
+			});
+		return i;
+	}
+	
+	virtual bool for_each_until(SinkRef<typename base_type::value_type> sink) override {
+		return push_until(stream, [&](auto&& value) {
+			return sink(typename base_type::value_type(std::forward<decltype(value)>(value)));
+		});
+	}
+	
 	virtual bool endless() const override {
 		return stream.endless();
 	}
 };
-template<typename T>
+
+// small streams are stored in place, others are allocated from Allocator, 
+// e.g. std::pmr::polymorphic_allocator<T> to draw them from a memory resource
+template<typename T, typename Allocator = std::allocator<T>>
 struct AnyStream {
-	StreamHolderBase<T>* holder;
+	using holder_type = StreamHolderBase<T, Allocator>;
+	using allocator_traits = std::allocator_traits<Allocator>;
 	
-	using value_type = T;
+	Allocator alloc;
+	holder_type* holder;
+	alignas(std::max_align_t) unsigned char buffer[inline_size];
 	
-	AnyStream() : holder(nullptr) {}
+	using value_type = T;
+	using allocator_type = Allocator;
 	
 	template<typename Stream>
-	AnyStream(Stream stream) 
-		: holder(new StreamHolder(stream)) {}
+	using enable_if_stream_t = std::enable_if_t<!std::is_same_v<std::decay_t<Stream>, AnyStream> 
+		&& !std::is_convertible_v<Stream, Allocator>>;
+	
+	AnyStream() : alloc(), holder(nullptr) {}
+	
+	explicit AnyStream(Allocator const& alloc) : alloc(alloc), holder(nullptr) {}
+	
+	template<typename Stream, typename = enable_if_stream_t<Stream>>
+	AnyStream(Stream stream, Allocator const& alloc = Allocator()) 
+		: alloc(alloc), holder(StreamHolder<Stream, Allocator>::create(std::move(stream), buffer, this->alloc)) {}
 	
 	AnyStream(AnyStream const& other)
-		: holder(other.holder ? other.holder->clone() : nullptr) {}
+		: alloc(allocator_traits::select_on_container_copy_construction(other.alloc)), holder(nullptr) {
+		if(other.holder)
+			holder = other.holder->clone(buffer, alloc);
+	}
 		
 	AnyStream(AnyStream && other)
-		: holder(std::exchange(other.holder, nullptr)) {}
+		: alloc(other.alloc), holder(nullptr) {
+		steal(other);
+	}
 	
-	template<typename Stream>
-	AnyStream& operator=(Stream const& stream) {
-		delete holder;
-		holder = new StreamHolder(stream);
+	template<typename Stream, typename = enable_if_stream_t<Stream>>
+	AnyStream& operator=(Stream stream) {
+		reset();
+		holder = StreamHolder<Stream, Allocator>::create(std::move(stream), buffer, alloc);
 		return *this;
 	}
 	
 	AnyStream& operator=(AnyStream const& other) {
-		delete holder;
-		holder = other.holder ? other.holder->clone() : nullptr;
+		if(this != &other) {
+			reset();
+			if constexpr(allocator_traits::propagate_on_container_copy_assignment::value)
+				alloc = other.alloc;
+			holder = other.holder ? other.holder->clone(buffer, alloc) : nullptr;
+		}
 		return *this;
 	}
 	
 	AnyStream& operator=(AnyStream && other) {
-		delete holder;
-		holder = std::exchange(other.holder, nullptr);
+		if(this != &other) {
+			reset();
+			if constexpr(allocator_traits::propagate_on_container_move_assignment::value)
+				alloc = other.alloc;
+			steal(other);
+		}
 		return *this;
 	}
 	
-#ifndef YAO_STREAM_NO_TYPEINFO
+	bool local() const {
+		return static_cast<void const*>(holder) == buffer;
+	}
+	
+	void reset() {
+		if(holder)
+			std::exchange(holder, nullptr)->destroy(alloc);
+	}
+	
+#ifndef CPP_STREAM_NO_TYPEINFO
 	const std::type_info& type() const {
 		return holder->type();
 	}
@@ -1197,6 +6485,16 @@ struct AnyStream {
 		return holder->next();
 	}
 	
+	// pulls up to n elements into out with one virtual call, returns the number written
+	size_t next_n(value_type* out, size_t n) {
+		return holder->next_n(out, n);
+	}
+	
+	template<typename Sink>
+	bool for_each_until(Sink&& sink) {
+		return holder->for_each_until(SinkRef<value_type>(sink));
+	}
+	
 	bool endless() const {
 		return holder->endless();
 	}
@@ -1204,14 +6502,41 @@ struct AnyStream {
 	Buildable;
 	
 	~AnyStream() {
-		delete holder;
+		reset();
 	}
 	
+private:
+	// the holder is taken over if it is allocated from an equal allocator, moved into this otherwise
+	void steal(AnyStream& other) {
+		if(!other.holder)
+			return;
+		if(!other.local() && alloc == other.alloc) {
+			holder = std::exchange(other.holder, nullptr);
+		} else {
+			holder = other.holder->move_to(buffer, alloc);
+			other.reset();
+		}
+	}
 };
+
 template<typename Stream>
 AnyStream(Stream stream) -> AnyStream<value_t<Stream>>;
 
-auto erase() { return make_builder([](auto stream) { return AnyStream(stream); } ); }
+template<typename Stream, typename Allocator>
+AnyStream(Stream stream, Allocator const& alloc) -> AnyStream<value_t<Stream>, Allocator>;
+
+inline auto erase() { return make_builder([](auto stream) { return AnyStream(std::move(stream)); } ); }
+
+// holds the stream in the memory resource of the nearest with_arena() upstream
+inline auto erase_in_arena() { 
+	return make_builder([](auto stream) { 
+		std::pmr::polymorphic_allocator<std::remove_cv_t<std::remove_reference_t<value_t<decltype(stream)>>>> alloc(memory_resource_of(stream));
+		return AnyStream(std::move(stream), alloc); 
+	}); 
+}
+
+template<typename Allocator>
+auto erase(Allocator alloc) { return make_builder([alloc](auto stream) { return AnyStream(std::move(stream), alloc); } ); }
 
 }
 
@@ -0,0 +1,205 @@
+#include "cppStream.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+using namespace yaossg::stream;
+
+#define CHECK(condition) \
+	((condition) ? void() : (std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition), std::abort()))
+
+template<typename Stream>
+std::vector<int> elements(Stream stream) {
+	std::vector<int> result;
+	stream >> for_each([&](int x) { result.push_back(x); });
+	return result;
+}
+
+// the result of a sliding window is overwritten by next(), so buffering stages must copy it
+void sliding_reduce_is_buffered_by_value() {
+	std::vector<int> data{5, 1, 4, 2, 3, 9, 0};
+	CHECK(elements(from(data) >> sliding_reduce(2, std::plus<>{}) >> sort()) == std::vector<int>({5, 5, 6, 6, 9, 12}));
+	CHECK(elements(from(data) >> sliding_reduce(2, std::plus<>{}, std::minus<>{}) >> sort()) == std::vector<int>({5, 5, 6, 6, 9, 12}));
+	CHECK(elements(from(data) >> sliding_reduce(2, std::plus<>{}, std::minus<>{}) >> reverse()) == std::vector<int>({9, 12, 5, 6, 5, 6}));
+	CHECK(elements(from(data) >> sliding_reduce(2, std::plus<>{}) >> distinct()) == std::vector<int>({6, 5, 12, 9}));
+}
+
+// partition reads the source once, so single pass sources keep all their elements
+void partition_reads_once() {
+	std::istringstream in("a\nbb\nccc\ndddd\neeeee\nffffff\n");
+	auto shards = from_lines(in) >> map([](std::string_view line) { return std::string(line); }) 
+		>> partition(2, [](std::string const& line) { return line.size(); });
+	CHECK(shards.size() == 2 && shards[0].size() == 3 && shards[1].size() == 3);
+	CHECK((shards[1] >> to_vector()) == std::vector<std::string>({"a", "ccc", "eeeee"}));
+	std::vector<int> data{1, 2, 3, 4, 5, 6, 7};
+	int calls = 0;
+	auto parts = from(data) >> peek([&](int) { ++calls; }) >> partition(3);
+	CHECK(calls == 7 && elements(gather(parts)) == std::vector<int>({3, 6, 1, 4, 7, 2, 5}));
+}
+
+// a reference returned by pred into a temporary front() of the upstream is copied instead of kept
+void map_copies_references_into_temporaries() {
+	auto identity = [](int const& x) -> int const& { return x; };
+	auto mapped = int_range(1, 4) >> map(identity);
+	static_assert(!MapStream<decltype(int_range(1, 4)), decltype(identity)>::referencing);
+	std::vector<int> data{1, 2, 3};
+	static_assert(MapStream<decltype(from(data)), decltype(identity)>::referencing);
+	CHECK(elements(mapped) == data);
+	auto larger = [](int const& a, int const& b) -> int const& { return a < b ? b : a; };
+	auto combined = combine_streams(larger, int_range(0, 6, 2), int_range(5, 2, -1));
+	static_assert(!decltype(combined)::referencing);
+	CHECK(elements(combined) == std::vector<int>({5, 4, 4}));
+}
+
+// partition of a sized random access source refers to its elements instead of copying them
+void partition_shares_random_access_sources() {
+	std::vector<std::string> words{"a", "bb", "ccc", "dddd", "eeeee"};
+	auto shards = from(words) >> partition(2, [](std::string const& word) { return word.size(); });
+	CHECK(shards.size() == 2 && shards[0].size() == 2 && shards[1].size() == 3);
+	CHECK(shards[0].next() && &shards[0].front() == &words[1]);
+	CHECK(shards[1].next() && &shards[1].front() == &words[0]);
+	shards[1].advance(1);
+	CHECK(shards[1].next() && &shards[1].front() == &words[4] && !shards[1].next());
+	std::vector<int> data{1, 2, 3, 4, 5, 6, 7};
+	CHECK(elements(gather(from(data) >> partition(3))) == std::vector<int>({3, 6, 1, 4, 7, 2, 5}));
+}
+
+// a predicate counting its copies, a copied stage copies its predicate too
+struct CountingEven {
+	int* copies;
+	
+	explicit CountingEven(int* copies) : copies(copies) {}
+	CountingEven(CountingEven const& other) : copies(other.copies) { ++*copies; }
+	CountingEven(CountingEven&& other) noexcept : copies(other.copies) {}
+	
+	bool operator()(int x) const { return x % 2 == 0; }
+};
+
+// stages and callables are moved through the pipeline, only a reused builder is copied, once each use
+void pipelines_move_callables() {
+	std::vector<int> data{1, 2, 3, 4, 5, 6, 7, 8};
+	int copies = 0;
+	auto first = from(data) >> filter(CountingEven(&copies)) >> map([](int x) { return x * 10; }) >> take(2);
+	CHECK((std::move(first) >> to_vector()) == std::vector<int>({20, 40}) && copies == 0);
+	auto even = filter(CountingEven(&copies));
+	CHECK((from(data) >> even >> take(1) >> to_vector()) == std::vector<int>({2}) && copies == 1);
+	CHECK((from(data) >> even >> to_vector()) == std::vector<int>({2, 4, 6, 8}) && copies == 2);
+}
+
+// the count of int_range is computed without overflowing near the limits of the type
+void int_range_counts_near_limits() {
+	constexpr int max = std::numeric_limits<int>::max(), min = std::numeric_limits<int>::min();
+	CHECK((int_range(max - 5, max, 4) >> to_vector()) == std::vector<int>({max - 5, max - 1}));
+	CHECK((int_range(0, max, max - 1) >> to_vector()) == std::vector<int>({0, max - 1}));
+	CHECK((int_range(min + 5, min, -4) >> to_vector()) == std::vector<int>({min + 5, min + 1}));
+	CHECK((int_range(0, min, min + 1) >> to_vector()) == std::vector<int>({0, min + 1}));
+	CHECK((int_range(10, 0, -3) >> to_vector()) == std::vector<int>({10, 7, 4, 1}));
+	CHECK((int_range(0u, 10u, 5u) >> count(size_t(0))) == 2 && (int_range(0, 10, -1) >> count(size_t(0))) == 0);
+}
+
+template<typename T>
+bool rejects(std::string const& bytes) {
+	std::istringstream in(bytes);
+	try {
+		deserialize_from<T>(in) >> for_each([](auto const&) {});
+	} catch(file_exception const&) {
+		return true;
+	}
+	return false;
+}
+
+// forged counts and sizes fail with file_exception instead of allocating or ending the stream early
+void deserialize_rejects_malformed_frames() {
+	std::string huge_size = std::string("\x05") + std::string(9, '\xFF') + "\x01";
+	CHECK(rejects<int>(huge_size));
+	CHECK(rejects<std::string>(huge_size));
+	std::string overflowing_count = std::string(9, '\x80') + "\x02";
+	CHECK(rejects<int>(overflowing_count));
+	// (2^62 + 1) * 4 wraps to 4
+	std::string wrapped = std::string("\x81") + std::string(8, '\x80') + "\x40" + "\x04" + "abcd" + std::string(1, '\0');
+	CHECK(rejects<int>(wrapped));
+	CHECK(rejects<std::string>(std::string("\x02\x02\x01x") + std::string(1, '\0')));
+	CHECK(rejects<int>(""));
+	std::stringstream valid;
+	std::vector<std::string> words{"alpha", "", std::string(100000, 'x')};
+	from(words) >> serialize_to(valid);
+	CHECK((deserialize_from<std::string>(valid) >> to_vector()) == words);
+	// elements encoded in no byte at all
+	std::stringstream empty;
+	from(std::vector<std::tuple<>>(3)) >> serialize_to(empty);
+	CHECK((deserialize_from<std::tuple<>>(empty) >> count(size_t(0))) == 3);
+	std::stringstream nested;
+	std::vector<std::vector<std::tuple<>>> lists{{}, std::vector<std::tuple<>>(5)};
+	from(lists) >> serialize_to(nested);
+	CHECK((deserialize_from<std::vector<std::tuple<>>>(nested) >> to_vector()) == lists);
+}
+
+#if !defined(CPP_STREAM_NO_PROFILE) && !defined(CPP_STREAM_NO_PARALLEL)
+// slices and reversals of a profiled stage count into the same node, from any thread
+void profile_passes_through_split_and_reverse() {
+	std::vector<int> data(10000, 1);
+	std::ostringstream out;
+	{
+		auto profiled = from(data) >> map([](int x) { return x * 2; }) >> profile("doubled", out);
+		static_assert(is_splittable_v<decltype(profiled)> && is_reversible_v<decltype(profiled)>);
+		auto shards = profiled >> split(3);
+		CHECK(elements(gather(shards)).size() == 10000);
+		WorkStealingPool pool(4);
+		CHECK((profiled >> reduce(parallel_policy{&pool, 256}, std::plus<>{})) == 20000);
+		CHECK((profiled >> reverse() >> reduce(std::plus<>{})) == 20000);
+	}
+	CHECK(out.str().find("doubled: out 30000,") != std::string::npos);
+}
+#endif
+
+#ifndef CPP_STREAM_NO_PARALLEL
+// a resource which is not synchronized, it remembers allocations from other threads than its owner
+struct ThreadCheckedResource : std::pmr::memory_resource {
+	std::pmr::monotonic_buffer_resource inner;
+	std::thread::id owner = std::this_thread::get_id();
+	bool foreign = false;
+	
+	void* do_allocate(size_t size, size_t alignment) override {
+		foreign |= std::this_thread::get_id() != owner;
+		return inner.allocate(size, alignment);
+	}
+	void do_deallocate(void*, size_t, size_t) override {}
+	bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override { return this == &other; }
+};
+
+// the arena of a parallel sort is used only on the calling thread
+void parallel_sort_allocates_on_caller() {
+	std::vector<std::pair<int, int>> data;
+	for(int i = 0; i < 100000; ++i)
+		data.emplace_back(i * 7919 % 1000, i);
+	WorkStealingPool pool(4);
+	ThreadCheckedResource arena;
+	auto by_key = [](auto const& a, auto const& b) { return a.first < b.first; };
+	auto sorted = from(data) >> with_arena(&arena) >> sort(parallel_policy{&pool, 1024}, by_key) >> to_vector();
+	auto expected = data;
+	std::stable_sort(expected.begin(), expected.end(), by_key);
+	CHECK(sorted == expected && !arena.foreign);
+}
+#endif
+
+int main() {
+	sliding_reduce_is_buffered_by_value();
+	partition_reads_once();
+	partition_shares_random_access_sources();
+	map_copies_references_into_temporaries();
+	pipelines_move_callables();
+	int_range_counts_near_limits();
+	deserialize_rejects_malformed_frames();
+#if !defined(CPP_STREAM_NO_PROFILE) && !defined(CPP_STREAM_NO_PARALLEL)
+	profile_passes_through_split_and_reverse();
+#endif
+#ifndef CPP_STREAM_NO_PARALLEL
+	parallel_sort_allocates_on_caller();
+#endif
+	std::puts("ok");
+}